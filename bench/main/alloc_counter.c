@@ -0,0 +1,40 @@
+#include "alloc_counter.h"
+
+// glibc exports its allocator under these names, the public ones below forward to them
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static size_t alloc_count = 0;
+
+void *malloc(size_t size)
+{
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    // growing an existing block is not a new allocation
+    if (ptr == NULL)
+    {
+        __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void alloc_counter_reset(void)
+{
+    __atomic_store_n(&alloc_count, 0, __ATOMIC_RELAXED);
+}
+
+size_t alloc_counter_get(void)
+{
+    return __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+
+    // The bench replaces malloc/calloc/realloc (glibc supports this) and counts every new block,
+    // including the ones strdup & co. allocate inside libc.
+
+    void alloc_counter_reset(void);
+    size_t alloc_counter_get(void);
+
+#ifdef __cplusplus
+}
+#endif
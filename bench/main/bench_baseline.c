@@ -0,0 +1,101 @@
+#include "bench_baseline.h"
+
+#include <esp_log.h>
+
+static const char *TAG = "[bench:baseline]";
+
+int bench_baseline_load(const char *path, bench_result_t *results, int max_results)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return 0;
+    }
+
+    char line[160];
+    int count = 0;
+    while (count < max_results && fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+
+        bench_result_t *r = &results[count];
+        if (sscanf(line, "%47s %lf %lf %lf", r->name, &r->ns_per_packet, &r->bytes_per_s, &r->allocs_per_payload) == 4)
+        {
+            count++;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Ignoring malformed baseline line: %s", line);
+        }
+    }
+
+    fclose(f);
+    return count;
+}
+
+esp_err_t bench_baseline_save(const char *path, const bench_result_t *results, int count)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        ESP_LOGE(TAG, "Could not open %s for writing", path);
+        return ESP_FAIL;
+    }
+
+    fprintf(f, "# name ns_per_packet bytes_per_s allocs_per_payload\n");
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(f, "%s %.3f %.1f %.3f\n",
+                results[i].name, results[i].ns_per_packet, results[i].bytes_per_s, results[i].allocs_per_payload);
+    }
+
+    fclose(f);
+    return ESP_OK;
+}
+
+int bench_baseline_compare(const bench_result_t *baseline, int baseline_count,
+                           const bench_result_t *results, int count,
+                           double threshold_pct)
+{
+    int regressions = 0;
+
+    printf("\n%-28s %14s %14s %9s %12s %12s\n", "case", "base ns/pkt", "ns/pkt", "delta", "base allocs", "allocs");
+
+    for (int i = 0; i < count; i++)
+    {
+        const bench_result_t *base = NULL;
+        for (int j = 0; j < baseline_count; j++)
+        {
+            if (strcmp(baseline[j].name, results[i].name) == 0)
+            {
+                base = &baseline[j];
+                break;
+            }
+        }
+
+        if (base == NULL)
+        {
+            printf("%-28s %14s %14.1f\n", results[i].name, "-", results[i].ns_per_packet);
+            continue;
+        }
+
+        double delta_pct = base->ns_per_packet == 0 ? 0 : (results[i].ns_per_packet / base->ns_per_packet - 1.0) * 100.0;
+        bool slower = delta_pct > threshold_pct;
+        bool more_allocs = results[i].allocs_per_payload > base->allocs_per_payload + 0.5;
+
+        printf("%-28s %14.1f %14.1f %+8.1f%% %12.1f %12.1f%s\n",
+               results[i].name, base->ns_per_packet, results[i].ns_per_packet, delta_pct,
+               base->allocs_per_payload, results[i].allocs_per_payload,
+               slower || more_allocs ? "  REGRESSION" : "");
+
+        if (slower || more_allocs)
+        {
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
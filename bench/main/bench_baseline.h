@@ -0,0 +1,33 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+#include <esp_err.h>
+
+#define BENCH_NAME_SIZE 48
+
+    typedef struct
+    {
+        char name[BENCH_NAME_SIZE];
+        double ns_per_packet;
+        double bytes_per_s;
+        double allocs_per_payload;
+    } bench_result_t;
+
+    // plain text, one "name ns_per_packet bytes_per_s allocs_per_payload" line per case
+    int bench_baseline_load(const char *path, bench_result_t *results, int max_results);
+    esp_err_t bench_baseline_save(const char *path, const bench_result_t *results, int count);
+
+    // prints the comparison and returns how many cases got slower than threshold_pct
+    // or allocate more than the baseline
+    int bench_baseline_compare(const bench_result_t *baseline, int baseline_count,
+                               const bench_result_t *results, int count,
+                               double threshold_pct);
+
+#ifdef __cplusplus
+}
+#endif
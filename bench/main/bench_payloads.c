@@ -0,0 +1,156 @@
+#include "bench_payloads.h"
+
+#include <internal/http_polling_handlers.h>
+
+#define BENCH_JSON_PAYLOAD_SIZE (64 * 1024)
+#define BENCH_BINARY_PACKETS 8
+#define BENCH_BINARY_PACKET_SIZE 1024
+
+static const char base64_table[65] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// growing string builder, asserts on OOM since this is only bench setup
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} builder_t;
+
+static void builder_reserve(builder_t *b, size_t extra)
+{
+    if (b->len + extra + 1 <= b->cap)
+    {
+        return;
+    }
+    while (b->len + extra + 1 > b->cap)
+    {
+        b->cap = b->cap == 0 ? 256 : b->cap * 2;
+    }
+    b->data = (char *)realloc(b->data, b->cap);
+    assert(b->data != NULL && "Out of memory");
+}
+
+static void builder_append(builder_t *b, const char *str, size_t len)
+{
+    builder_reserve(b, len);
+    memcpy(b->data + b->len, str, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+}
+
+static void builder_append_str(builder_t *b, const char *str)
+{
+    builder_append(b, str, strlen(str));
+}
+
+static void builder_append_base64(builder_t *b, const unsigned char *src, size_t len)
+{
+    builder_reserve(b, (len + 2) / 3 * 4);
+
+    char *out = b->data + b->len;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3)
+    {
+        *out++ = base64_table[src[i] >> 2];
+        *out++ = base64_table[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+        *out++ = base64_table[((src[i + 1] & 0x0f) << 2) | (src[i + 2] >> 6)];
+        *out++ = base64_table[src[i + 2] & 0x3f];
+    }
+    if (i < len)
+    {
+        *out++ = base64_table[src[i] >> 2];
+        if (i + 1 == len)
+        {
+            *out++ = base64_table[(src[i] & 0x03) << 4];
+            *out++ = '=';
+        }
+        else
+        {
+            *out++ = base64_table[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+            *out++ = base64_table[(src[i + 1] & 0x0f) << 2];
+        }
+        *out++ = '=';
+    }
+
+    b->len = out - b->data;
+    b->data[b->len] = '\0';
+}
+
+void bench_payload_create(bench_payload_id_t id, bench_payload_t *payload)
+{
+    builder_t b = {0};
+    char scratch[64];
+
+    switch (id)
+    {
+    case BENCH_PAYLOAD_PING:
+        payload->name = "ping";
+        payload->packet_count = 1;
+        builder_append_str(&b, "2");
+        break;
+
+    case BENCH_PAYLOAD_BATCH_100:
+        payload->name = "batch_100";
+        payload->packet_count = 100;
+        for (int i = 0; i < payload->packet_count; i++)
+        {
+            if (i > 0)
+            {
+                builder_append_str(&b, ASCII_RS_STRING);
+            }
+            snprintf(scratch, sizeof(scratch), "42[\"telemetry\",{\"seq\":%d,\"value\":%d.5}]", i, i * 3);
+            builder_append_str(&b, scratch);
+        }
+        break;
+
+    case BENCH_PAYLOAD_JSON_64K:
+        payload->name = "json_64k";
+        payload->packet_count = 1;
+        builder_append_str(&b, "42[\"samples\",{\"values\":[");
+        for (int i = 0; b.len < BENCH_JSON_PAYLOAD_SIZE; i++)
+        {
+            snprintf(scratch, sizeof(scratch), "%s%d", i == 0 ? "" : ",", (i * 7919) % 100000);
+            builder_append_str(&b, scratch);
+        }
+        builder_append_str(&b, "]}]");
+        break;
+
+    case BENCH_PAYLOAD_BINARY_BASE64:
+    {
+        payload->name = "binary_b64";
+        payload->packet_count = BENCH_BINARY_PACKETS;
+
+        unsigned char raw[BENCH_BINARY_PACKET_SIZE];
+        for (int i = 0; i < sizeof(raw); i++)
+        {
+            raw[i] = (unsigned char)(i * 31 + 7);
+        }
+
+        for (int i = 0; i < payload->packet_count; i++)
+        {
+            if (i > 0)
+            {
+                builder_append_str(&b, ASCII_RS_STRING);
+            }
+            builder_append_str(&b, "b");
+            builder_append_base64(&b, raw, sizeof(raw) - i); // vary the padding
+        }
+        break;
+    }
+
+    default:
+        assert(false && "Unknown payload");
+        break;
+    }
+
+    payload->body = b.data;
+    payload->len = b.len;
+}
+
+void bench_payload_free(bench_payload_t *payload)
+{
+    free(payload->body);
+    payload->body = NULL;
+    payload->len = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+
+    // Synthetic Engine.IO polling response bodies, exactly what a server would put in a long-poll answer
+    typedef struct
+    {
+        const char *name;
+        char *body;       // NUL terminated
+        size_t len;       // without the terminator
+        int packet_count; // packets separated by ASCII RS
+    } bench_payload_t;
+
+    typedef enum
+    {
+        BENCH_PAYLOAD_PING = 0,      // "2"
+        BENCH_PAYLOAD_BATCH_100,     // 100 small events separated by RS
+        BENCH_PAYLOAD_JSON_64K,      // one ~64 KB event
+        BENCH_PAYLOAD_BINARY_BASE64, // 8 'b' packets with 1 KB of base64 encoded data each
+        BENCH_PAYLOAD_MAX
+    } bench_payload_id_t;
+
+    void bench_payload_create(bench_payload_id_t id, bench_payload_t *payload);
+    void bench_payload_free(bench_payload_t *payload);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE // memmem
+
+#include "loopback_server.h"
+
+#include <esp_log.h>
+
+#include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static const char *TAG = "[bench:loopback]";
+
+#define LOOPBACK_MAX_CONNECTIONS 8
+#define LOOPBACK_REQUEST_BUFFER 4096
+
+typedef struct
+{
+    int fd;
+    char buffer[LOOPBACK_REQUEST_BUFFER];
+    size_t len;
+} loopback_connection_t;
+
+static int listen_fd = -1;
+static int stop_pipe[2] = {-1, -1};
+static pthread_t server_thread;
+static bool server_thread_running = false;
+
+static pthread_mutex_t body_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *poll_body = NULL;
+static size_t poll_body_len = 0;
+static size_t poll_chunk_size = 0;
+
+static size_t request_count = 0;
+static size_t connection_count = 0;
+
+static loopback_connection_t connections[LOOPBACK_MAX_CONNECTIONS];
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool respond_chunked(int fd, const char *body, size_t body_len, size_t chunk_size)
+{
+    static const char header[] = "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/plain; charset=UTF-8\r\n"
+                                 "Transfer-Encoding: chunked\r\n"
+                                 "Connection: keep-alive\r\n\r\n";
+    if (!send_all(fd, header, sizeof(header) - 1))
+    {
+        return false;
+    }
+
+    for (size_t offset = 0; offset < body_len; offset += chunk_size)
+    {
+        size_t len = body_len - offset < chunk_size ? body_len - offset : chunk_size;
+        char size_line[16];
+        int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+
+        if (!send_all(fd, size_line, size_len) || !send_all(fd, body + offset, len) || !send_all(fd, "\r\n", 2))
+        {
+            return false;
+        }
+    }
+    return send_all(fd, "0\r\n\r\n", 5);
+}
+
+static bool respond(int fd, const char *body, size_t body_len)
+{
+    char header[160];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: text/plain; charset=UTF-8\r\n"
+                              "Content-Length: %zu\r\n"
+                              "Connection: keep-alive\r\n\r\n",
+                              body_len);
+
+    return send_all(fd, header, header_len) && send_all(fd, body, body_len);
+}
+
+// returns the total size of the request (headers + body) once it is complete, 0 while incomplete
+static size_t complete_request_size(const loopback_connection_t *conn)
+{
+    const char *end = memmem(conn->buffer, conn->len, "\r\n\r\n", 4);
+    if (end == NULL)
+    {
+        return 0;
+    }
+
+    size_t header_len = (end - conn->buffer) + 4;
+    size_t content_length = 0;
+
+    for (const char *line = conn->buffer; line < end; line = strstr(line, "\r\n") + 2)
+    {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            content_length = strtoul(line + 15, NULL, 10);
+            break;
+        }
+    }
+
+    if (conn->len < header_len + content_length)
+    {
+        return 0;
+    }
+    return header_len + content_length;
+}
+
+static bool handle_readable(loopback_connection_t *conn)
+{
+    ssize_t n = recv(conn->fd, conn->buffer + conn->len, sizeof(conn->buffer) - conn->len, 0);
+    if (n <= 0)
+    {
+        return false;
+    }
+    conn->len += n;
+
+    size_t request_size;
+    while ((request_size = complete_request_size(conn)) > 0)
+    {
+        bool ok;
+        request_count++;
+
+        if (strncmp(conn->buffer, "POST", 4) == 0)
+        {
+            ok = respond(conn->fd, "ok", 2);
+        }
+        else
+        {
+            pthread_mutex_lock(&body_lock);
+            if (poll_chunk_size > 0)
+            {
+                ok = respond_chunked(conn->fd, poll_body == NULL ? "" : poll_body, poll_body_len, poll_chunk_size);
+            }
+            else
+            {
+                ok = respond(conn->fd, poll_body == NULL ? "" : poll_body, poll_body_len);
+            }
+            pthread_mutex_unlock(&body_lock);
+        }
+
+        memmove(conn->buffer, conn->buffer + request_size, conn->len - request_size);
+        conn->len -= request_size;
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    if (conn->len == sizeof(conn->buffer))
+    {
+        ESP_LOGE(TAG, "Request exceeds %d bytes, dropping connection", LOOPBACK_REQUEST_BUFFER);
+        return false;
+    }
+    return true;
+}
+
+static void *loopback_server_thread(void *arg)
+{
+    struct pollfd fds[LOOPBACK_MAX_CONNECTIONS + 2];
+
+    for (;;)
+    {
+        fds[0].fd = stop_pipe[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = listen_fd;
+        fds[1].events = POLLIN;
+        for (int i = 0; i < LOOPBACK_MAX_CONNECTIONS; i++)
+        {
+            fds[i + 2].fd = connections[i].fd;
+            fds[i + 2].events = POLLIN;
+            fds[i + 2].revents = 0;
+        }
+
+        if (poll(fds, LOOPBACK_MAX_CONNECTIONS + 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ESP_LOGE(TAG, "poll failed %d", errno);
+            break;
+        }
+
+        if (fds[0].revents)
+        {
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            int fd = accept(listen_fd, NULL, NULL);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < LOOPBACK_MAX_CONNECTIONS; i++)
+            {
+                if (connections[i].fd < 0)
+                {
+                    slot = i;
+                    break;
+                }
+            }
+
+            if (slot < 0)
+            {
+                if (fd >= 0)
+                {
+                    ESP_LOGW(TAG, "Too many connections");
+                    close(fd);
+                }
+            }
+            else
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                connections[slot].fd = fd;
+                connections[slot].len = 0;
+                connection_count++;
+            }
+        }
+
+        for (int i = 0; i < LOOPBACK_MAX_CONNECTIONS; i++)
+        {
+            if (connections[i].fd >= 0 && fds[i + 2].revents != 0 &&
+                !handle_readable(&connections[i]))
+            {
+                close(connections[i].fd);
+                connections[i].fd = -1;
+            }
+        }
+    }
+
+    for (int i = 0; i < LOOPBACK_MAX_CONNECTIONS; i++)
+    {
+        if (connections[i].fd >= 0)
+        {
+            close(connections[i].fd);
+            connections[i].fd = -1;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t loopback_server_start(uint16_t *port_out)
+{
+    assert(listen_fd < 0 && "Loopback server already running");
+
+    for (int i = 0; i < LOOPBACK_MAX_CONNECTIONS; i++)
+    {
+        connections[i].fd = -1;
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        ESP_LOGE(TAG, "socket failed %d", errno);
+        return ESP_FAIL;
+    }
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = 0, // let the kernel pick
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    socklen_t addr_len = sizeof(addr);
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, LOOPBACK_MAX_CONNECTIONS) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        pipe(stop_pipe) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to set up listening socket %d", errno);
+        close(listen_fd);
+        listen_fd = -1;
+        return ESP_FAIL;
+    }
+
+    request_count = 0;
+    connection_count = 0;
+
+    server_thread_running = pthread_create(&server_thread, NULL, loopback_server_thread, NULL) == 0;
+    if (!server_thread_running)
+    {
+        ESP_LOGE(TAG, "Failed to start server thread");
+        loopback_server_stop();
+        return ESP_FAIL;
+    }
+
+    *port_out = ntohs(addr.sin_port);
+    ESP_LOGI(TAG, "Listening on 127.0.0.1:%u", *port_out);
+    return ESP_OK;
+}
+
+void loopback_server_stop(void)
+{
+    if (server_thread_running)
+    {
+        (void)!write(stop_pipe[1], "x", 1);
+        pthread_join(server_thread, NULL);
+        server_thread_running = false;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (stop_pipe[i] >= 0)
+        {
+            close(stop_pipe[i]);
+            stop_pipe[i] = -1;
+        }
+    }
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+
+    pthread_mutex_lock(&body_lock);
+    free(poll_body);
+    poll_body = NULL;
+    poll_body_len = 0;
+    pthread_mutex_unlock(&body_lock);
+}
+
+void loopback_server_set_poll_body(const char *body, size_t len)
+{
+    char *copy = (char *)malloc(len + 1);
+    assert(copy != NULL && "Out of memory");
+    memcpy(copy, body, len);
+    copy[len] = '\0';
+
+    pthread_mutex_lock(&body_lock);
+    free(poll_body);
+    poll_body = copy;
+    poll_body_len = len;
+    pthread_mutex_unlock(&body_lock);
+}
+
+void loopback_server_set_chunk_size(size_t chunk_size)
+{
+    pthread_mutex_lock(&body_lock);
+    poll_chunk_size = chunk_size;
+    pthread_mutex_unlock(&body_lock);
+}
+
+size_t loopback_server_get_request_count(void)
+{
+    return request_count;
+}
+
+size_t loopback_server_get_connection_count(void)
+{
+    return connection_count;
+}
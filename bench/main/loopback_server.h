@@ -0,0 +1,29 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+#include <esp_err.h>
+
+    // Minimal stand-in for a socket.io server on 127.0.0.1.
+    // Every GET is answered with the currently configured poll body, every POST with "ok".
+    // Connections are kept alive so the http clients behave like they do against a real server.
+
+    esp_err_t loopback_server_start(uint16_t *port_out);
+    void loopback_server_stop(void);
+
+    // body is copied, safe to call between requests (not during one)
+    void loopback_server_set_poll_body(const char *body, size_t len);
+
+    // answer polls with "Transfer-Encoding: chunked" in chunks of chunk_size, 0 uses Content-Length
+    void loopback_server_set_chunk_size(size_t chunk_size);
+
+    size_t loopback_server_get_request_count(void);
+    size_t loopback_server_get_connection_count(void);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
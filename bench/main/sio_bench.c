@@ -0,0 +1,760 @@
+// Host benchmark for the hot paths of the component, build for the linux target:
+//   idf.py --preview set-target linux && idf.py build && ./build/sio_bench.elf
+//
+// Environment:
+//   SIO_BENCH_BASELINE       baseline file (default sio_bench_baseline.txt)
+//   SIO_BENCH_SAVE_BASELINE  set to 1 to store this run as the new baseline
+//   SIO_BENCH_THRESHOLD      allowed slowdown in percent before a case counts as regression (default 10)
+// The exit code is 1 if any case regressed against the baseline.
+
+#include <sio_client.h>
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <internal/sio_send.h>
+#include <internal/http_polling_handlers.h>
+#include <internal/sio_stream.h>
+#include <internal/sio_router.h>
+#include <internal/sio_json.h>
+#include <internal/sio_ack.h>
+#include <utility.h>
+
+#include "loopback_server.h"
+#include "alloc_counter.h"
+#include "bench_payloads.h"
+#include "bench_baseline.h"
+
+#include <esp_log.h>
+#include <time.h>
+
+static const char *TAG = "[sio_bench]";
+
+#define BENCH_WARMUP_ITERATIONS 16
+#define BENCH_MAX_RESULTS 32
+#define BENCH_DEFAULT_BASELINE "sio_bench_baseline.txt"
+#define BENCH_DEFAULT_THRESHOLD_PCT 10.0
+
+// esp_http_client hands the body to the handler in chunks of its receive buffer
+#define BENCH_HTTP_FRAGMENT_SIZE MAX_HTTP_RECV_BUFFER
+
+static bench_result_t results[BENCH_MAX_RESULTS];
+static int result_count = 0;
+
+static int64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_record(const char *name, int iterations, int packets_per_iteration,
+                         size_t bytes_per_iteration, int64_t elapsed_ns, size_t allocs)
+{
+    assert(result_count < BENCH_MAX_RESULTS && "Increase BENCH_MAX_RESULTS");
+
+    bench_result_t *r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->ns_per_packet = (double)elapsed_ns / ((double)iterations * packets_per_iteration);
+    r->bytes_per_s = elapsed_ns == 0 ? 0 : ((double)bytes_per_iteration * iterations * 1e9) / elapsed_ns;
+    r->allocs_per_payload = (double)allocs / iterations;
+
+    printf("%-28s %10d it %14.1f ns/pkt %10.2f MB/s %10.1f allocs\n",
+           r->name, iterations, r->ns_per_packet, r->bytes_per_s / 1e6, r->allocs_per_payload);
+}
+
+static void bench_parse_packet(const bench_payload_t *payload, int iterations)
+{
+    char name[BENCH_NAME_SIZE];
+    snprintf(name, sizeof(name), "parse_packet/%s", payload->name);
+
+    // split once up front, only parse_packet is measured
+    char *split_body = strdup(payload->body);
+    char *slices[payload->packet_count];
+    int slice_count = 0;
+    for (char *s = strtok(split_body, ASCII_RS_STRING); s != NULL && slice_count < payload->packet_count;
+         s = strtok(NULL, ASCII_RS_STRING))
+    {
+        slices[slice_count++] = s;
+    }
+    assert(slice_count == payload->packet_count);
+
+    Packet_t packets[payload->packet_count];
+
+    int64_t elapsed = 0;
+    size_t allocs = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        // parse_packet replaces the data of binary packets, so every round gets fresh copies
+        for (int p = 0; p < slice_count; p++)
+        {
+            packets[p] = (Packet_t){.data = strdup(slices[p]), .len = strlen(slices[p])};
+        }
+
+        alloc_counter_reset();
+        int64_t start = bench_now_ns();
+        for (int p = 0; p < slice_count; p++)
+        {
+            parse_packet(&packets[p]);
+        }
+        int64_t end = bench_now_ns();
+
+        if (i >= BENCH_WARMUP_ITERATIONS)
+        {
+            elapsed += end - start;
+            allocs += alloc_counter_get();
+        }
+
+        for (int p = 0; p < slice_count; p++)
+        {
+            free(packets[p].data);
+        }
+    }
+
+    bench_record(name, iterations, payload->packet_count, payload->len, elapsed, allocs);
+    free(split_body);
+}
+
+// Feeds the payload straight into the handler the same way esp_http_client does (ON_DATA fragments, then
+// ON_FINISH), without the socket in between. The client handle is primed with one real GET of the payload
+// so content length & chunked state match what the handler sees in production.
+static void bench_polling_handler(const bench_payload_t *payload, int iterations, uint16_t port)
+{
+    char name[BENCH_NAME_SIZE];
+    snprintf(name, sizeof(name), "polling_handler/%s", payload->name);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/socket.io/?EIO=4&transport=polling", port);
+    loopback_server_set_poll_body(payload->body, payload->len);
+
+    sio_stream_t stream = {0};
+    esp_http_client_config_t config = {
+        .url = url,
+        .event_handler = http_client_polling_get_handler,
+        .user_data = &stream,
+        .disable_auto_redirect = true,
+        .timeout_ms = 5000};
+    esp_http_client_handle_t http_client = esp_http_client_init(&config);
+    assert(http_client != NULL && "Failed to init http client");
+
+    esp_err_t err = esp_http_client_perform(http_client);
+    PacketPointerArray_t packets = stream.packets;
+    stream.packets = NULL;
+    if (err != ESP_OK || get_array_size(packets) != payload->packet_count)
+    {
+        ESP_LOGE(TAG, "Priming GET for %s failed: %s, got %d packets", payload->name, esp_err_to_name(err), get_array_size(packets));
+        if (packets != NULL)
+        {
+            free_packet_arr(&packets);
+        }
+        esp_http_client_cleanup(http_client);
+        return;
+    }
+    free_packet_arr(&packets);
+
+    esp_http_client_event_t evt = {
+        .client = http_client,
+        .user_data = &stream};
+
+    int64_t start = 0;
+    size_t allocs = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        if (i == BENCH_WARMUP_ITERATIONS)
+        {
+            alloc_counter_reset();
+            start = bench_now_ns();
+        }
+
+        evt.event_id = HTTP_EVENT_ON_DATA;
+        for (size_t offset = 0; offset < payload->len; offset += BENCH_HTTP_FRAGMENT_SIZE)
+        {
+            size_t remaining = payload->len - offset;
+            evt.data = payload->body + offset;
+            evt.data_len = remaining < BENCH_HTTP_FRAGMENT_SIZE ? remaining : BENCH_HTTP_FRAGMENT_SIZE;
+            http_client_polling_get_handler(&evt);
+        }
+
+        evt.event_id = HTTP_EVENT_ON_FINISH;
+        evt.data = NULL;
+        evt.data_len = 0;
+        http_client_polling_get_handler(&evt);
+
+        packets = stream.packets;
+        stream.packets = NULL;
+        assert(get_array_size(packets) == payload->packet_count);
+        free_packet_arr(&packets);
+    }
+    int64_t elapsed = bench_now_ns() - start;
+    allocs = alloc_counter_get();
+
+    bench_record(name, iterations, payload->packet_count, payload->len, elapsed, allocs);
+    esp_http_client_cleanup(http_client);
+}
+
+static void bench_polling_get(uint16_t port, size_t chunk_size)
+{
+    const int iterations = 2000;
+
+    bench_payload_t payload;
+    bench_payload_create(BENCH_PAYLOAD_BATCH_100, &payload);
+    loopback_server_set_poll_body(payload.body, payload.len);
+    loopback_server_set_chunk_size(chunk_size);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/socket.io/?EIO=4&transport=polling", port);
+
+    sio_stream_t stream = {0};
+    esp_http_client_config_t config = {
+        .url = url,
+        .event_handler = http_client_polling_get_handler,
+        .user_data = &stream,
+        .disable_auto_redirect = true,
+        .timeout_ms = 5000};
+    esp_http_client_handle_t http_client = esp_http_client_init(&config);
+    assert(http_client != NULL && "Failed to init http client");
+
+    int64_t start = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        if (i == BENCH_WARMUP_ITERATIONS)
+        {
+            alloc_counter_reset();
+            start = bench_now_ns();
+        }
+
+        esp_err_t err = esp_http_client_perform(http_client);
+        PacketPointerArray_t packets = stream.packets;
+        stream.packets = NULL;
+
+        if (err != ESP_OK || get_array_size(packets) != payload.packet_count)
+        {
+            ESP_LOGE(TAG, "Polling GET failed: %s, got %d packets", esp_err_to_name(err), get_array_size(packets));
+            break;
+        }
+        free_packet_arr(&packets);
+    }
+    int64_t elapsed = bench_now_ns() - start;
+
+    bench_record(chunk_size == 0 ? "loopback/polling_get" : "loopback/polling_get_chunked",
+                 iterations, payload.packet_count, payload.len, elapsed, alloc_counter_get());
+
+    loopback_server_set_chunk_size(0);
+    esp_http_client_cleanup(http_client);
+    bench_payload_free(&payload);
+}
+
+// client that looks connected to the loopback server without a handshake
+static sio_client_id_t bench_client_create(uint16_t port)
+{
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", port);
+
+    sio_client_config_t config = {
+        .server_address = address,
+        .transport = SIO_TRANSPORT_POLLING};
+    sio_client_id_t client_id = sio_client_init(&config);
+    assert(client_id >= 0 && "Failed to init client");
+
+    // pretend the handshake happened
+    sio_client_t *client = sio_client_get_and_lock(client_id);
+    client->_server_session_id = strdup("bench-session");
+    client->post_url = alloc_session_url(client, &client->post_url_token);
+    sio_client_set_status(client, SIO_CLIENT_STATUS_CONNECTED);
+    ESP_ERROR_CHECK(sio_sender_start(client));
+    unlockClient(client);
+
+    return client_id;
+}
+
+static void bench_client_destroy(sio_client_id_t client_id)
+{
+    sio_client_t *client = sio_client_get_and_lock(client_id);
+    sio_client_set_status(client, SIO_CLIENT_STATUS_CLOSED);
+    unlockClient(client);
+    sio_client_destroy(client_id);
+}
+
+static void bench_send_polling(uint16_t port)
+{
+    const int iterations = 2000;
+
+    sio_client_id_t client_id = bench_client_create(port);
+    Packet_t *packet = alloc_message("{\"sensor\":\"temperature\",\"value\":21.5}", "event");
+
+    int64_t start = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        if (i == BENCH_WARMUP_ITERATIONS)
+        {
+            alloc_counter_reset();
+            start = bench_now_ns();
+        }
+
+        sio_client_t *client = sio_client_get_and_lock(client_id);
+        esp_err_t err = sio_send_packet_polling(client, packet);
+        unlockClient(client);
+
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Polling POST failed: %s", esp_err_to_name(err));
+            break;
+        }
+    }
+    int64_t elapsed = bench_now_ns() - start;
+
+    bench_record("loopback/send_polling", iterations, 1, packet->len, elapsed, alloc_counter_get());
+
+    sio_post_stats_t stats;
+    ESP_ERROR_CHECK(sio_client_get_post_stats(client_id, &stats));
+    printf("%-28s %lu POSTs over a kept connection, %lu opened one\n", "",
+           (unsigned long)stats.reused, (unsigned long)stats.connected);
+
+    free_packet(&packet);
+    bench_client_destroy(client_id);
+}
+
+#define BENCH_BURST_SENDERS 4
+#define BENCH_BURST_PACKETS 500
+
+typedef struct
+{
+    sio_client_id_t client_id;
+    const Packet_t *packet;
+    SemaphoreHandle_t finished;
+} bench_burst_sender_t;
+
+static void bench_burst_sender_task(void *pvParameters)
+{
+    bench_burst_sender_t *sender = (bench_burst_sender_t *)pvParameters;
+
+    for (int i = 0; i < BENCH_BURST_PACKETS; i++)
+    {
+        if (sio_send_packet(sender->client_id, sender->packet) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Burst send failed");
+            break;
+        }
+    }
+
+    xSemaphoreGive(sender->finished);
+    vTaskDelete(NULL);
+}
+
+// several tasks sending at once, their packets should share POSTs instead of queueing for the client lock
+static void bench_send_burst(uint16_t port)
+{
+    sio_client_id_t client_id = bench_client_create(port);
+    Packet_t *packet = alloc_message("{\"sensor\":\"temperature\",\"value\":21.5}", "event");
+
+    bench_burst_sender_t sender = {
+        .client_id = client_id,
+        .packet = packet,
+        .finished = xSemaphoreCreateCounting(BENCH_BURST_SENDERS, 0)};
+
+    size_t requests_before = loopback_server_get_request_count();
+    alloc_counter_reset();
+    int64_t start = bench_now_ns();
+
+    for (int i = 0; i < BENCH_BURST_SENDERS; i++)
+    {
+        xTaskCreate(&bench_burst_sender_task, "bench_burst", 4096, &sender, 5, NULL);
+    }
+    for (int i = 0; i < BENCH_BURST_SENDERS; i++)
+    {
+        xSemaphoreTake(sender.finished, portMAX_DELAY);
+    }
+
+    int64_t elapsed = bench_now_ns() - start;
+    size_t posts = loopback_server_get_request_count() - requests_before;
+
+    bench_record("loopback/send_burst", BENCH_BURST_PACKETS, BENCH_BURST_SENDERS,
+                 packet->len * BENCH_BURST_SENDERS, elapsed, alloc_counter_get());
+    printf("%-28s %d packets in %zu POSTs\n", "", BENCH_BURST_SENDERS * BENCH_BURST_PACKETS, posts);
+
+    vSemaphoreDelete(sender.finished);
+    free_packet(&packet);
+    bench_client_destroy(client_id);
+}
+
+typedef struct
+{
+    SemaphoreHandle_t finished;
+    SemaphoreHandle_t slot_freed;
+    int remaining;
+    int failed;
+} bench_async_state_t;
+
+static void bench_async_sent(sio_client_id_t client_id, esp_err_t result, void *ctx)
+{
+    bench_async_state_t *state = (bench_async_state_t *)ctx;
+    if (result != ESP_OK)
+    {
+        state->failed++;
+    }
+    xSemaphoreGive(state->slot_freed);
+    if (--state->remaining == 0)
+    {
+        xSemaphoreGive(state->finished);
+    }
+}
+
+// one producer emitting without waiting, only the sender task talks to the server
+static void bench_send_async(uint16_t port)
+{
+    const int packets = BENCH_BURST_SENDERS * BENCH_BURST_PACKETS;
+    const char *json = "{\"sensor\":\"temperature\",\"value\":21.5}";
+
+    sio_client_id_t client_id = bench_client_create(port);
+    bench_async_state_t state = {
+        .finished = xSemaphoreCreateBinary(),
+        .slot_freed = xSemaphoreCreateBinary(),
+        .remaining = packets};
+
+    size_t requests_before = loopback_server_get_request_count();
+    alloc_counter_reset();
+    int64_t start = bench_now_ns();
+    int64_t blocked_ns = 0;
+
+    for (int i = 0; i < packets; i++)
+    {
+        int64_t emit_start = bench_now_ns();
+        while (sio_emit_async(client_id, "event", json, bench_async_sent, &state) == ESP_ERR_NO_MEM)
+        {
+            // queue full, the sender is behind
+            xSemaphoreTake(state.slot_freed, portMAX_DELAY);
+        }
+        blocked_ns += bench_now_ns() - emit_start;
+    }
+    xSemaphoreTake(state.finished, portMAX_DELAY);
+
+    int64_t elapsed = bench_now_ns() - start;
+    size_t posts = loopback_server_get_request_count() - requests_before;
+
+    bench_record("loopback/send_async", packets, 1, strlen(json), elapsed, alloc_counter_get());
+    printf("%-28s %d packets in %zu POSTs, %d failed, %.1f us per emit call\n", "",
+           packets, posts, state.failed, blocked_ns / 1e3 / packets);
+
+    vSemaphoreDelete(state.finished);
+    vSemaphoreDelete(state.slot_freed);
+    bench_client_destroy(client_id);
+}
+
+// a sensor reading as cJSON tree, the way applications usually hand their emits over
+static cJSON *bench_emit_json(void)
+{
+    return cJSON_Parse("{\"sensor\":\"temperature\",\"value\":21.5,\"timestamp\":1700000000}");
+}
+
+// cJSON_PrintUnformatted + alloc_message (print buffer, then the packet buffer) against
+// the in-place builder that prints straight into a pooled packet buffer
+static void bench_emit_build(bool in_place, int iterations)
+{
+    cJSON *json = bench_emit_json();
+    sio_event_desc_t event;
+    ESP_ERROR_CHECK(sio_event_desc_init(&event, "reading"));
+
+    size_t len = 0;
+    int64_t start = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        if (i == BENCH_WARMUP_ITERATIONS)
+        {
+            alloc_counter_reset();
+            start = bench_now_ns();
+        }
+
+        Packet_t *packet = NULL;
+        if (in_place)
+        {
+            packet = alloc_event(&event, sio_emit_write_cjson, json);
+        }
+        else
+        {
+            char *printed = cJSON_PrintUnformatted(json);
+            packet = alloc_message(printed, "reading");
+            cJSON_free(printed);
+        }
+        len = packet->len;
+        free_packet(&packet);
+    }
+    int64_t elapsed = bench_now_ns() - start;
+
+    bench_record(in_place ? "emit/cjson_in_place" : "emit/cjson_print_copy", iterations, 1, len, elapsed, alloc_counter_get());
+
+    sio_event_desc_free(&event);
+    cJSON_Delete(json);
+}
+
+static void bench_route_handler(sio_client_id_t client_id, const Packet_t *packet, const char *args, size_t args_len, void *ctx)
+{
+    (*(size_t *)ctx) += args_len;
+}
+
+// What a SIO_EVENT_RECEIVED_MESSAGE consumer does to find the event name (cJSON_Parse of every message)
+// against sio_on routing that only hashes the name, over the 100 event batch with a few other events registered
+static void bench_route(const bench_payload_t *payload, bool routed, int iterations)
+{
+    static const char *events[] = {"telemetry", "config", "command", "status", "alarm", "ota", "log", "time"};
+
+    sio_client_config_t config = {.server_address = "127.0.0.1"};
+    sio_client_id_t client_id = sio_client_init(&config);
+    assert(client_id >= 0 && "Failed to init client");
+
+    size_t handled = 0;
+    if (routed)
+    {
+        for (int e = 0; e < sizeof(events) / sizeof(events[0]); e++)
+        {
+            ESP_ERROR_CHECK(sio_on(client_id, events[e], bench_route_handler, &handled));
+        }
+    }
+
+    int64_t elapsed = 0;
+    size_t allocs = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        char *body = (char *)malloc(payload->len + 1);
+        memcpy(body, payload->body, payload->len + 1);
+        PacketPointerArray_t packets = alloc_packet_arr(body, payload->len, NULL, NULL);
+
+        alloc_counter_reset();
+        int64_t start = bench_now_ns();
+        if (routed)
+        {
+            sio_router_dispatch(client_id, packets);
+        }
+        else
+        {
+            for (int p = 0; packets[p] != NULL; p++)
+            {
+                cJSON *json = cJSON_Parse(packets[p]->json_start);
+                cJSON *name = cJSON_GetArrayItem(json, 0);
+                if (cJSON_IsString(name) && strcmp(name->valuestring, events[0]) == 0)
+                {
+                    handled += packets[p]->len;
+                }
+                cJSON_Delete(json);
+            }
+        }
+        int64_t end = bench_now_ns();
+
+        if (i >= BENCH_WARMUP_ITERATIONS)
+        {
+            elapsed += end - start;
+            allocs += alloc_counter_get();
+        }
+        free_packet_arr(&packets);
+    }
+
+    bench_record(routed ? "route/sio_on" : "route/cjson_name", iterations, payload->packet_count, payload->len, elapsed, allocs);
+    assert(handled > 0);
+
+    sio_client_destroy(client_id);
+}
+
+// reading one field of every event: a cJSON tree against tokens on the stack
+static void bench_json_field(const bench_payload_t *payload, bool tokens, int iterations)
+{
+    char *body = (char *)malloc(payload->len + 1);
+    memcpy(body, payload->body, payload->len + 1);
+    PacketPointerArray_t packets = alloc_packet_arr(body, payload->len, NULL, NULL);
+
+    double sum = 0;
+    alloc_counter_reset();
+    int64_t start = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        if (i == BENCH_WARMUP_ITERATIONS)
+        {
+            alloc_counter_reset();
+            start = bench_now_ns();
+        }
+
+        for (int p = 0; packets[p] != NULL; p++)
+        {
+            if (tokens)
+            {
+                sio_json_token_t tokens[16];
+                sio_json_t json;
+                double value;
+                if (sio_json_parse_packet(&json, packets[p], tokens, 16) == ESP_OK &&
+                    sio_json_number(&json, sio_json_find(&json, "[1].value"), &value) == ESP_OK)
+                {
+                    sum += value;
+                }
+            }
+            else
+            {
+                cJSON *json = cJSON_Parse(packets[p]->json_start);
+                cJSON *value = cJSON_GetObjectItem(cJSON_GetArrayItem(json, 1), "value");
+                if (cJSON_IsNumber(value))
+                {
+                    sum += value->valuedouble;
+                }
+                cJSON_Delete(json);
+            }
+        }
+    }
+    int64_t elapsed = bench_now_ns() - start;
+
+    bench_record(tokens ? "json_field/sio_json" : "json_field/cjson", iterations, payload->packet_count, payload->len, elapsed, alloc_counter_get());
+    assert(sum > 0);
+
+    free_packet_arr(&packets);
+}
+
+static void bench_ack_cb(sio_client_id_t client_id, esp_err_t result, const Packet_t *packet, const char *args, size_t args_len, void *ctx)
+{
+    (*(size_t *)ctx) += result == ESP_OK ? 1 : 0;
+}
+
+// registering an ack and matching its answer with BENCH_ACKS_IN_FLIGHT others waiting on the wheel
+#define BENCH_ACKS_IN_FLIGHT 31
+
+static void bench_ack(int iterations)
+{
+    sio_client_config_t config = {.server_address = "127.0.0.1"};
+    sio_client_id_t client_id = sio_client_init(&config);
+    assert(client_id >= 0 && "Failed to init client");
+    sio_client_t *client = sio_client_get(client_id);
+
+    size_t acked = 0;
+    uint32_t id;
+    for (int i = 0; i < BENCH_ACKS_IN_FLIGHT; i++)
+    {
+        ESP_ERROR_CHECK(sio_ack_add(&client->acks, client_id, bench_ack_cb, &acked, 60000, &id));
+    }
+
+    char answer[32];
+    int64_t elapsed = 0;
+    size_t allocs = 0;
+    size_t len = 0;
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS + iterations; i++)
+    {
+        ESP_ERROR_CHECK(sio_ack_add(&client->acks, client_id, bench_ack_cb, &acked, 60000, &id));
+        len = snprintf(answer, sizeof(answer), "43%lu[\"ok\"]", (unsigned long)id);
+        char *body = (char *)malloc(len + 1);
+        memcpy(body, answer, len + 1);
+        PacketPointerArray_t packets = alloc_packet_arr(body, len, NULL, NULL);
+
+        alloc_counter_reset();
+        int64_t start = bench_now_ns();
+        sio_ack_dispatch(client_id, packets);
+        int64_t end = bench_now_ns();
+
+        if (i >= BENCH_WARMUP_ITERATIONS)
+        {
+            elapsed += end - start;
+            allocs += alloc_counter_get();
+        }
+        free_packet_arr(&packets);
+    }
+
+    bench_record("ack/dispatch", iterations, 1, len, elapsed, allocs);
+    assert(acked == BENCH_WARMUP_ITERATIONS + iterations);
+
+    sio_client_destroy(client_id);
+}
+
+static int bench_iterations_for(const bench_payload_t *payload)
+{
+    // roughly the same amount of bytes for every payload so each case runs for a similar time
+    size_t iterations = (64 * 1024 * 1024) / (payload->len + 1);
+    if (iterations < 200)
+    {
+        iterations = 200;
+    }
+    if (iterations > 200000)
+    {
+        iterations = 200000;
+    }
+    return (int)iterations;
+}
+
+void app_main(void)
+{
+    const char *baseline_path = getenv("SIO_BENCH_BASELINE");
+    const char *save_baseline = getenv("SIO_BENCH_SAVE_BASELINE");
+    const char *threshold_str = getenv("SIO_BENCH_THRESHOLD");
+
+    baseline_path = baseline_path == NULL ? BENCH_DEFAULT_BASELINE : baseline_path;
+    double threshold_pct = threshold_str == NULL ? BENCH_DEFAULT_THRESHOLD_PCT : atof(threshold_str);
+
+    uint16_t port = 0;
+    ESP_ERROR_CHECK(loopback_server_start(&port));
+
+    for (bench_payload_id_t id = 0; id < BENCH_PAYLOAD_MAX; id++)
+    {
+        bench_payload_t payload;
+        bench_payload_create(id, &payload);
+
+        int iterations = bench_iterations_for(&payload);
+        bench_parse_packet(&payload, iterations);
+        bench_polling_handler(&payload, iterations, port);
+
+        bench_payload_free(&payload);
+    }
+
+    {
+        bench_payload_t payload;
+        bench_payload_create(BENCH_PAYLOAD_BATCH_100, &payload);
+        bench_route(&payload, false, bench_iterations_for(&payload));
+        bench_route(&payload, true, bench_iterations_for(&payload));
+        bench_json_field(&payload, false, bench_iterations_for(&payload));
+        bench_json_field(&payload, true, bench_iterations_for(&payload));
+        bench_payload_free(&payload);
+    }
+
+    bench_ack(200000);
+
+    bench_emit_build(false, 200000);
+    bench_emit_build(true, 200000);
+
+    bench_polling_get(port, 0);
+    bench_polling_get(port, 256);
+    bench_send_polling(port);
+    bench_send_burst(port);
+    bench_send_async(port);
+
+    printf("loopback server: %zu requests over %zu connections\n",
+           loopback_server_get_request_count(), loopback_server_get_connection_count());
+
+    sio_pool_stats_t packet_pool, batch_pool;
+    sio_packet_pool_stats(&packet_pool, &batch_pool);
+    printf("packet pool: %u/%u in use, high water %u, %lu heap fallbacks\n",
+           packet_pool.in_use, packet_pool.size, packet_pool.high_water, (unsigned long)packet_pool.heap_fallbacks);
+    printf("batch pool: %u/%u in use, high water %u, %lu heap fallbacks\n",
+           batch_pool.in_use, batch_pool.size, batch_pool.high_water, (unsigned long)batch_pool.heap_fallbacks);
+
+    sio_pool_stats_t emit_pool;
+    sio_emit_pool_stats(&emit_pool);
+    printf("emit pool: %u/%u in use, high water %u, %lu heap fallbacks\n",
+           emit_pool.in_use, emit_pool.size, emit_pool.high_water, (unsigned long)emit_pool.heap_fallbacks);
+    loopback_server_stop();
+
+    int exit_code = 0;
+    if (save_baseline != NULL && strcmp(save_baseline, "1") == 0)
+    {
+        if (bench_baseline_save(baseline_path, results, result_count) == ESP_OK)
+        {
+            printf("Saved baseline to %s\n", baseline_path);
+        }
+    }
+    else
+    {
+        bench_result_t baseline[BENCH_MAX_RESULTS];
+        int baseline_count = bench_baseline_load(baseline_path, baseline, BENCH_MAX_RESULTS);
+
+        if (baseline_count == 0)
+        {
+            printf("No baseline at %s, run with SIO_BENCH_SAVE_BASELINE=1 to create one\n", baseline_path);
+        }
+        else
+        {
+            int regressions = bench_baseline_compare(baseline, baseline_count, results, result_count, threshold_pct);
+            printf("%d regression(s) over %.1f%% against %s\n", regressions, threshold_pct, baseline_path);
+            exit_code = regressions > 0 ? 1 : 0;
+        }
+    }
+
+    exit(exit_code);
+}
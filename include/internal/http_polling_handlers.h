@@ -10,6 +10,7 @@ extern "C"
 #define ASCII_RS_STRING ""
 #define ASCII_RS_INDEX = 30
 
+    // user_data of the http client has to point to the sio_stream_t that receives the body
     esp_err_t http_client_polling_get_handler(esp_http_client_event_t *evt);
 
     esp_err_t http_client_polling_post_handler(esp_http_client_event_t *evt);
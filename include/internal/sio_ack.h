@@ -0,0 +1,59 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <esp_err.h>
+
+// resolution of the ack timeouts, all clients share one wheel that turns every SIO_ACK_WHEEL_SLOTS ticks
+#define SIO_ACK_WHEEL_TICK_MS 100
+#define SIO_ACK_WHEEL_SLOTS 64
+
+    // Result of an emit with ack: ESP_OK with the ack packet and its raw arguments ('1,{"a":2}' of '431[1,{"a":2}]',
+    // not terminated, both only valid during the call), ESP_ERR_TIMEOUT, ESP_ERR_INVALID_STATE if the client went
+    // away or the error of the failed send (packet NULL then). Runs on the receiving task for acks, on the ack task
+    // for timeouts and on the sender task for failed sends, so it must not block.
+    typedef void (*sio_ack_cb_t)(sio_client_id_t client_id, esp_err_t result, const Packet_t *packet, const char *args, size_t args_len, void *ctx);
+
+    typedef struct sio_ack_t
+    {
+        uint32_t id;
+        bool pending;
+        sio_client_id_t client_id;
+        sio_ack_cb_t cb;
+        void *ctx;
+        uint32_t expires;                 // wheel tick it times out on
+        struct sio_ack_t *next, *prev;    // in the wheel slot of expires
+    } sio_ack_t;
+
+    // Outstanding acks of a client, the id picks the slot so an ack is found without searching
+    typedef struct
+    {
+        sio_ack_t slots[CONFIG_SIO_ACK_SLOTS];
+        uint32_t next_id;
+    } sio_ack_table_t;
+
+    // the lock and wheel shared by all clients, the task turning the wheel starts with the first ack
+    esp_err_t sio_ack_init(void);
+
+    // Registers an ack that times out after timeout_ms, *id is what goes into the emit. ESP_ERR_NO_MEM if all
+    // CONFIG_SIO_ACK_SLOTS are waiting.
+    esp_err_t sio_ack_add(sio_ack_table_t *table, sio_client_id_t client_id, sio_ack_cb_t cb, void *ctx, uint32_t timeout_ms, uint32_t *id);
+    // Removes the ack without calling its callback (the emit could not be queued)
+    void sio_ack_remove(sio_ack_table_t *table, uint32_t id);
+    // Calls and removes the ack with result if it is still waiting
+    void sio_ack_fail(sio_ack_table_t *table, uint32_t id, esp_err_t result);
+    // every ack still waiting gets ESP_ERR_INVALID_STATE, before the table goes away
+    void sio_ack_cancel_all(sio_ack_table_t *table);
+
+    // Hands the acks of the batch to their callbacks and takes them out of the array (free'd after the call).
+    // Acks nobody waits for anymore (timed out) stay and go out as SIO_EVENT_RECEIVED_MESSAGE.
+    void sio_ack_dispatch(sio_client_id_t client_id, PacketPointerArray_t packets);
+
+#ifdef __cplusplus
+}
+#endif
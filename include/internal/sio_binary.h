@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <internal/sio_packet.h>
+
+    // Binary events arrive as a header ("451-[...{"_placeholder":true,"num":0}]") followed by one 'b' packet per
+    // attachment, possibly spread over several polls. The assembler keeps the header until all are in.
+    typedef struct
+    {
+        Packet_t *pending; // header still waiting for attachments
+    } sio_binary_assembler_t;
+
+    // Moves attachments into their header and compacts packets in place: a complete header takes the slot
+    // of its last attachment, an incomplete one leaves the array and waits in the assembler.
+    // The array may be empty afterwards, it still has to be free'd.
+    void sio_binary_assemble(sio_binary_assembler_t *assembler, PacketPointerArray_t packets);
+
+    // drops a pending header and the attachments collected so far
+    void sio_binary_assembler_reset(sio_binary_assembler_t *assembler);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <esp_err.h>
+
+    // With CONFIG_SIO_IO_TASK one task polls and sends for every client instead of a polling and a sender
+    // task each. Polls and POSTs are async esp_http_client requests that get CONFIG_SIO_IO_SLICE_MS per round,
+    // then the next client has its turn. The task starts with the first client.
+
+    // the polling / the sender of a connecting client moves onto the I/O task
+    esp_err_t sio_io_add_polling(sio_client_id_t clientId);
+    esp_err_t sio_io_add_sender(sio_client_id_t clientId);
+
+    // something was queued to send
+    void sio_io_wake(void);
+
+    // called from the I/O task, blocking sends would wait for themselves there
+    bool sio_io_is_current(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <internal/sio_packet.h>
+#include <esp_err.h>
+#include <esp_types.h>
+
+    typedef enum
+    {
+        SIO_JSON_UNDEFINED = 0,
+        SIO_JSON_OBJECT,
+        SIO_JSON_ARRAY,
+        SIO_JSON_STRING,   // start / end without the quotes, escapes left as they are
+        SIO_JSON_PRIMITIVE // number, true, false or null
+    } sio_json_type_t;
+
+    // jsmn style: a token only marks where a value is in the text, an object key is a string whose single
+    // child is its value. Tokens are in document order, children follow their parent.
+    typedef struct
+    {
+        sio_json_type_t type;
+        int start; // offset of the first byte
+        int end;   // offset behind the last byte, -1 while a container is still open
+        int size;  // children: elements of an array, keys of an object, 1 for a key
+    } sio_json_token_t;
+
+    typedef struct
+    {
+        const char *data;
+        sio_json_token_t *tokens;
+        int count;
+    } sio_json_t;
+
+    // Tokenizes the first json value of data into tokens (caller owned, nothing is allocated). Stops behind that
+    // value, trailing bytes are ignored. ESP_ERR_NO_MEM if max_tokens is too small, ESP_ERR_INVALID_ARG if the
+    // json is malformed or cut off. json keeps pointers to data and tokens.
+    esp_err_t sio_json_parse(sio_json_t *json, const char *data, size_t len, sio_json_token_t *tokens, size_t max_tokens);
+
+    // the json of a packet (json_start up to its end), for events '["name",arg1,...]' so "[1]" is the first argument
+    esp_err_t sio_json_parse_packet(sio_json_t *json, const Packet_t *packet, sio_json_token_t *tokens, size_t max_tokens);
+
+    // Value under path, relative to the root: "sid", "[1].temperature", "values[2]", "a.b[0].c".
+    // Keys are compared as they are in the text. NULL if there is no such value.
+    const sio_json_token_t *sio_json_find(const sio_json_t *json, const char *path);
+
+    // value of key in the object token, NULL if it is no object or has no such key
+    const sio_json_token_t *sio_json_get(const sio_json_t *json, const sio_json_token_t *object, const char *key);
+    // element index of the array token, NULL if it is no array or too short
+    const sio_json_token_t *sio_json_at(const sio_json_t *json, const sio_json_token_t *array, int index);
+
+    // The string as a view into the text (not terminated, escapes not decoded). false if token is no string.
+    bool sio_json_string(const sio_json_t *json, const sio_json_token_t *token, const char **str, size_t *len);
+    // true if token is a string equal to str (compared without decoding escapes)
+    bool sio_json_equals(const sio_json_t *json, const sio_json_token_t *token, const char *str);
+    // Decodes the string (escapes, \u to UTF-8) into out with a terminator. Returns the decoded length,
+    // >= out_len means it was cut off. -1 if token is no string.
+    int sio_json_copy_string(const sio_json_t *json, const sio_json_token_t *token, char *out, size_t out_len);
+
+    // ESP_ERR_INVALID_ARG if token is NULL or no value of that type
+    esp_err_t sio_json_number(const sio_json_t *json, const sio_json_token_t *token, double *value);
+    esp_err_t sio_json_int(const sio_json_t *json, const sio_json_token_t *token, int32_t *value);
+    esp_err_t sio_json_bool(const sio_json_t *json, const sio_json_token_t *token, bool *value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <internal/task_functions.h>
+#include <esp_err.h>
+
+    struct sio_client_t;
+
+    typedef struct
+    {
+        char *name; // '/name', NULL for a free slot
+        size_t name_len;
+        const char *(*alloc_auth_body_cb)(const struct sio_client_t *client); // optional, like the one of the client
+        bool pending;   // CONNECT sent on the current session, no answer yet
+        bool connected; // the server accepted the CONNECT of the current session
+    } sio_namespace_t;
+
+    // Namespaces joined over the session of the client besides the main one, changed under the client lock
+    typedef struct
+    {
+        sio_namespace_t joined[CONFIG_SIO_NAMESPACES];
+        uint8_t count; // read without the lock to drop packets of other namespaces while nothing is joined
+    } sio_namespaces_t;
+
+    // client locked, replaces the auth callback of a namespace already joined
+    esp_err_t sio_namespace_add(sio_namespaces_t *namespaces, const char *nsp, const char *(*alloc_auth_body_cb)(const struct sio_client_t *client));
+    // client locked, ESP_ERR_NOT_FOUND if the namespace was not joined
+    esp_err_t sio_namespace_remove(sio_namespaces_t *namespaces, const char *nsp);
+    void sio_namespace_clear(sio_namespaces_t *namespaces);
+    // client locked, a new session: every namespace has to connect again
+    void sio_namespace_reset(sio_namespaces_t *namespaces);
+
+    // sio_packet_filter_t of the receiving side (ctx is its sio_receive_state_t), keeps packets of the main namespace
+    // and of the joined ones. The attachments of a binary packet it drops go with it.
+    bool sio_namespace_filter(const char *data, size_t len, void *ctx);
+    // the same for an attachment that arrives on its own (binary websocket frame), false drops it
+    bool sio_namespace_filter_attachment(sio_receive_state_t *state);
+
+    // Follows the servers answers to the CONNECTs of the joined namespaces ('40/name,', '44/name,', '41/name,') and
+    // connects them once the main namespace is. Nothing leaves the array.
+    void sio_namespace_track(sio_client_id_t client_id, const PacketPointerArray_t packets);
+
+#ifdef __cplusplus
+}
+#endif
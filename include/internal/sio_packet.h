@@ -15,30 +15,92 @@ extern "C"
 
 #include <sio_types.h>
 #include <esp_types.h>
+#include <esp_err.h>
+#include <internal/sio_pool.h>
 
-    typedef struct
+    typedef struct sio_packet_batch_t sio_packet_batch_t;
+
+    typedef struct Packet_t
     {
         eio_packet_t eio_type;
         sio_packet_t sio_type;
 
         char *json_start; // pointer inside buffer pointing to the start of the data (start of the json)
+        int32_t ack_id;   // received messages: the id in front of the json ("421[...]", "431[...]"), -1 without
+
+        // received messages of another namespace than the main one: '/name' inside data ("42/name,[...]"), NULL otherwise
+        const char *nsp;
+        size_t nsp_len;
 
         char *data; // raw data
         size_t len;
+
+        sio_packet_batch_t *batch; // != NULL if data is a view into a shared receive buffer, the packet does not own data then
+
+        // binary events / acks ("451-[...]"), attachments are joined by sio_binary_assemble
+        uint8_t attachment_count;       // announced in the header
+        uint8_t attachments_received;   // == attachment_count once the packet is handed out
+        struct Packet_t **attachments;  // in placeholder order, owned by this packet and free'd with it
     } Packet_t;
 
+    // NULL terminated, always allocated by alloc_packet_arr (never build one yourself)
     typedef Packet_t **PacketPointerArray_t;
 
+    // Looks at the raw bytes of a packet (terminated) before it is parsed, false drops it
+    typedef bool (*sio_packet_filter_t)(const char *data, size_t len, void *ctx);
+
     void parse_packet(Packet_t *packet_p);
 
-    // locks internally
+    // '/name' of a socket.io packet of another namespace ('42/name,[...]', '451-/name,[...]') in *nsp and its length,
+    // 0 for the main namespace and everything else
+    size_t sio_packet_namespace(const char *data, size_t len, const char **nsp);
+    // attachments announced by a binary event / ack ('451-[...]'), -1 if there is no valid count
+    int sio_packet_attachment_count(const char *data, size_t len);
+
+    // Slices a polling body at ASCII_RS into parsed packets that point into buffer instead of copying.
+    // Takes ownership of buffer (needs one spare byte after len for the terminator).
+    // Packets filter (optional) rejects take no slot and are not parsed.
+    // The array, the packets and the buffer are free'd once the last of them is released
+    // through free_packet / free_packet_arr. Returns NULL if there is no packet in the buffer.
+    PacketPointerArray_t alloc_packet_arr(char *buffer, size_t len, sio_packet_filter_t filter, void *filter_ctx);
+
+    // A binary websocket frame as a single attachment packet (raw bytes, no 'b' prefix or base64),
+    // same ownership rules as alloc_packet_arr.
+    PacketPointerArray_t alloc_binary_packet_arr(char *buffer, size_t len);
+
+    // '42["event_str",json_str]' ('42' + json_str without an event), the name is escaped
     Packet_t *alloc_message(const char *json_str, const char *event_str);
+    // alloc_message into another namespace: '42/nsp,["event_str",json_str]', nsp NULL or "/" is the main one
+    Packet_t *alloc_namespace_message(const char *nsp, const char *json_str, const char *event_str);
+
+    // Emit builders: header, arguments (written in place by writer, may be NULL) and the closing bracket
+    // go into one buffer from the emit pool (CONFIG_SIO_EMIT_BUFFER_SIZE), bigger ones into one heap buffer.
+    Packet_t *alloc_event(const sio_event_desc_t *event, sio_emit_writer_t writer, void *ctx);
+    Packet_t *alloc_event_named(const char *name, sio_emit_writer_t writer, void *ctx);
+
+    // JSON string escaping (quotes not included) of an event name the way JSON.stringify does it,
+    // out == NULL only counts. Returns the escaped length, out gets no terminator.
+    size_t sio_json_escape(char *out, const char *in);
+
+    // '42<ack_id>["event_str",json_str]', an emit the server acknowledges with '43<ack_id>[...]'
+    Packet_t *alloc_ack_message(const char *json_str, const char *event_str, uint32_t ack_id);
+
+    // engine.io packet without payload (ping, pong, close...), comes from the packet pool without a data allocation
+    Packet_t *alloc_control_packet(eio_packet_t type);
 
     int get_array_size(PacketPointerArray_t arr);
 
+    // decoded bytes of the attachment a {"_placeholder":true,"num":num} in the json refers to,
+    // a view that lives as long as the packet. NULL if there is no such attachment.
+    const char *get_attachment(const Packet_t *packet, uint8_t num, size_t *len);
+
     void free_packet(Packet_t **packet_p_p);
     void free_packet_arr(PacketPointerArray_t *arr_p_p);
 
+    // occupancy of the packet pools (CONFIG_SIO_PACKET_POOL_SIZE / CONFIG_SIO_PACKET_BATCH_POOL_SIZE), either may be NULL
+    void sio_packet_pool_stats(sio_pool_stats_t *packets, sio_pool_stats_t *batches);
+    void sio_emit_pool_stats(sio_pool_stats_t *buffers);
+
     void print_packet(const Packet_t *packet_p);
     void print_packet_arr(PacketPointerArray_t arr);
     // util
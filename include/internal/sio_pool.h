@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+#include "freertos/FreeRTOS.h"
+
+    typedef struct
+    {
+        uint16_t size;           // blocks in the pool
+        uint16_t in_use;         // blocks currently handed out
+        uint16_t high_water;     // most blocks ever handed out at once
+        uint32_t heap_fallbacks; // allocations that found the pool empty and went to the heap
+    } sio_pool_stats_t;
+
+    // Fixed size block pool over static storage, falls back to the heap when it is exhausted
+    // so callers never see a difference besides where the memory comes from.
+    typedef struct
+    {
+        char *storage;
+        size_t block_size;
+        uint16_t block_count;
+
+        uint16_t untouched; // blocks never handed out start here, saves building the free list up front
+        void *free_list;    // released blocks, linked through their first bytes
+
+        sio_pool_stats_t stats;
+        portMUX_TYPE lock;
+    } sio_pool_t;
+
+    // static storage for `count` blocks of `type` (count may be 0, every allocation goes to the heap then)
+#define SIO_POOL_DEFINE(name, type, count)                           \
+    static union {                                                   \
+        type block;                                                  \
+        void *next;                                                  \
+    } name##_storage[(count) > 0 ? (count) : 1];                     \
+    static sio_pool_t name = {                                       \
+        .storage = (char *)name##_storage,                           \
+        .block_size = sizeof(name##_storage[0]),                     \
+        .block_count = (count),                                      \
+        .untouched = 0,                                              \
+        .free_list = NULL,                                           \
+        .stats = {.size = (count)},                                  \
+        .lock = portMUX_INITIALIZER_UNLOCKED}
+
+    // not zeroed
+    void *sio_pool_alloc(sio_pool_t *pool);
+
+    // accepts blocks of the pool and heap fallbacks alike, NULL is ignored
+    void sio_pool_free(sio_pool_t *pool, void *block);
+
+    bool sio_pool_owns(const sio_pool_t *pool, const void *block);
+
+    sio_pool_stats_t sio_pool_get_stats(sio_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <esp_err.h>
+
+#include "freertos/FreeRTOS.h"
+
+// offsets are kept in place, servers use short ids ("<timestamp>-<seq>" and alike), longer ones are not recovered
+#define SIO_RECOVERY_OFFSET_SIZE 64
+
+    struct sio_client_t;
+
+    typedef struct
+    {
+        uint16_t attempts;                     // failed attempts since the last connect, doubles the backoff window
+        TickType_t not_before;                 // the worker starts the next attempt from this tick on
+        char *pid;                             // private session id for connection state recovery, NULL if the server has none
+        char offset[SIO_RECOVERY_OFFSET_SIZE]; // last event offset as it was in the json (escaped), receiving task only
+        bool recovered;                        // the server restored the session of pid on the last connect
+    } sio_reconnect_t;
+
+    // Full jitter: uniformly random below min(CONFIG_SIO_RECONNECT_DELAY_MAX_MS, CONFIG_SIO_RECONNECT_DELAY_MS * 2^attempts)
+    uint32_t sio_reconnect_delay_ms(uint16_t attempts);
+
+    // Client locked. Puts a client that lost its connection (or failed to get one) back to SIO_CLIENT_STARTING
+    // with a backoff the worker waits out. false if reconnecting is off or CONFIG_SIO_RECONNECT_ATTEMPTS ran out.
+    bool sio_reconnect_schedule(struct sio_client_t *client);
+    // ticks until a scheduled attempt is due, 0 if it is
+    TickType_t sio_reconnect_due_in(const sio_reconnect_t *reconnect);
+    // the next attempt starts right away with the smallest window (connected, or started by hand)
+    void sio_reconnect_reset(sio_reconnect_t *reconnect);
+    // forgets the recovery session, before the client goes away
+    void sio_reconnect_clear(sio_reconnect_t *reconnect);
+
+    // Keeps the pid of the servers CONNECT and the offset (last string argument) of every event after it.
+    // Nothing leaves the array.
+    void sio_recovery_track(sio_client_id_t client_id, const PacketPointerArray_t packets);
+
+    // The auth object of the CONNECT with pid and offset added ('{"pid":"..","offset":"..",<auth>}'), NULL if there
+    // is no session to recover (or auth is no object), the caller sends auth as it is then.
+    char *sio_recovery_alloc_auth(const sio_reconnect_t *reconnect, const char *auth);
+
+#ifdef __cplusplus
+}
+#endif
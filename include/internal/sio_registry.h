@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <stddef.h>
+
+// An id is '<generation><slot>': the slot indexes the registry, the generation changes every time the slot is
+// taken again, so an id kept after sio_client_destroy never finds the client that took its place.
+#define SIO_REGISTRY_SLOT_BITS 8
+#define SIO_REGISTRY_SLOT_MASK ((1 << SIO_REGISTRY_SLOT_BITS) - 1)
+#define SIO_REGISTRY_GENERATION_MASK (INT32_MAX >> SIO_REGISTRY_SLOT_BITS)
+#define SIO_REGISTRY_SLOT(id) ((size_t)(id) & SIO_REGISTRY_SLOT_MASK)
+
+// slots are allocated in chunks as clients come and never freed, lookups go without a lock
+#define SIO_REGISTRY_CHUNK_SIZE 8
+
+    struct sio_client_t;
+
+    // Gives the client the id of a free slot and publishes it. -1 once CONFIG_SIO_MAX_PARALLEL_SOCKETS are taken
+    // (or no chunk could be allocated). The registration holds a reference of the client until it is removed.
+    sio_client_id_t sio_registry_add(struct sio_client_t *client);
+    // Lookups of the id fail from here on. The client stays until the last reference is released, the slot is
+    // taken again after that. false if the id was removed already, its reference is gone then.
+    bool sio_registry_remove(sio_client_id_t id);
+
+    // O(1), NULL for ids that were never handed out or whose client is gone. Not pinned, only for callers
+    // that keep the client alive otherwise.
+    struct sio_client_t *sio_registry_get(sio_client_id_t id);
+
+    // O(1) like sio_registry_get, but the client is pinned until sio_registry_release
+    struct sio_client_t *sio_registry_acquire(sio_client_id_t id);
+    // another reference of a client the caller holds one of already
+    void sio_registry_pin(sio_client_id_t id);
+    // drops a reference, the last one of a removed client frees it (sio_client_free) and the slot
+    void sio_registry_release(sio_client_id_t id);
+
+    // slots handed out so far, to walk all clients with sio_registry_id_at
+    size_t sio_registry_slots(void);
+    // id of the client in the slot, -1 if it is free
+    sio_client_id_t sio_registry_id_at(size_t slot);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <esp_err.h>
+
+    // Gets an event registered with sio_on on the task receiving it (polling or websocket task), so it must not
+    // block or use the blocking send functions. args is the raw json after the event name without the closing
+    // bracket ('{"a":1},2' for '42["name",{"a":1},2]'), not terminated, empty without arguments.
+    // packet (binary attachments, ack id) and args are only valid during the call.
+    typedef void (*sio_on_handler_t)(sio_client_id_t client_id, const Packet_t *packet, const char *args, size_t args_len, void *ctx);
+
+    typedef struct
+    {
+        uint32_t hash; // of name
+        char *name;    // json escaped like on the wire, NULL for a free slot
+        size_t name_len;
+        sio_on_handler_t handler;
+        void *ctx;
+    } sio_route_t;
+
+    // Open addressing (linear probing) over CONFIG_SIO_ROUTER_SIZE slots, changed under the client lock
+    typedef struct
+    {
+        sio_route_t routes[CONFIG_SIO_ROUTER_SIZE];
+        uint8_t count; // read without the lock to skip routing while nothing is registered
+    } sio_router_t;
+
+    // client locked, replaces the handler of an event already registered
+    esp_err_t sio_router_add(sio_router_t *router, const char *event, sio_on_handler_t handler, void *ctx);
+    // client locked, ESP_ERR_NOT_FOUND if the event has no handler
+    esp_err_t sio_router_remove(sio_router_t *router, const char *event);
+    void sio_router_clear(sio_router_t *router);
+
+    // Hands every event of the batch that has a handler to it and takes it out of the array (free'd after the call),
+    // what is left goes out as SIO_EVENT_RECEIVED_MESSAGE. Only the '["name",' in front is looked at, no json parsing.
+    void sio_router_dispatch(sio_client_id_t client_id, PacketPointerArray_t packets);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <esp_types.h>
+
+    // Scans [start, end) a machine word at a time for the next ASCII_RS.
+    // On the way it remembers the first '{' or '[' before the delimiter in *json_start (untouched if there is none),
+    // so splitting a polling body and finding the json of every packet is a single pass.
+    // Returns the delimiter or end if there is no further one.
+    char *sio_scan_packet(char *start, char *end, char **json_start);
+
+#ifdef __cplusplus
+}
+#endif
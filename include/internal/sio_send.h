@@ -9,12 +9,63 @@ extern "C"
 {
 #endif
 
+    // A packet waiting for the sender task. Blocking sends keep it on the stack of the waiting task (done != NULL),
+    // async ones allocate it and own the packet.
+    typedef struct sio_outbound_t
+    {
+        struct sio_outbound_t *next;
+        Packet_t *packet;
+
+        sio_send_cb_t on_sent;
+        void *on_sent_ctx;
+
+        esp_err_t result;
+        SemaphoreHandle_t done;
+        StaticSemaphore_t done_buffer;
+    } sio_outbound_t;
+
+    // The POST a sender has on its way. On the I/O task posting_client is async and a POST takes a few rounds,
+    // the send lock stays taken from its start until it is done.
+    typedef struct
+    {
+        sio_outbound_t *batch; // first packet of the body, NULL while no POST runs
+        size_t count;
+        char *body; // NULL for a single packet, it goes out as it is
+        uint32_t connections;
+        TickType_t started;
+        bool retried;
+    } sio_post_t;
+
+    // what a sender carries from one round to the next
+    typedef struct
+    {
+        sio_outbound_t *pending; // oldest first
+        sio_post_t post;
+    } sio_sender_t;
+
+// network timeout of a POST, one that ran this long is never sent again
+#define SIO_POST_TIMEOUT_MS 5000
+
+// outbound_head while no sender takes packets (before sio_sender_start and after it stopped), pushes fail then
+#define SIO_OUTBOUND_CLOSED ((sio_outbound_t *)1)
+
     esp_err_t sio_send_string(const sio_client_id_t clientId, const char *data);
     esp_err_t sio_send_packet(const sio_client_id_t clientId, const Packet_t *packet);
 
-    // NOT THREAD SAVE
+    // One pass over what is queued for the client, sender carries what is left and a POST still on its way to
+    // the next one. false once the client is closed and nothing is left, sender_running is dropped then.
+    bool sio_sender_round(sio_client_t *client, sio_sender_t *sender);
+
+    // the sender (task or I/O task) looks at the queue and the client status right away
+    void sio_sender_wake(sio_client_t *client);
+
+    // Starts the task that POSTs everything queued for the client, client locked
+    esp_err_t sio_sender_start(sio_client_t *client);
+
+    // Direct POST of one packet bypassing the queue (handshake, before the sender runs).
+    // Client has to be locked, the lock is released while waiting for the POST.
     esp_err_t sio_send_packet_polling(sio_client_t *client, const Packet_t *packet);
-    // NOT THREAD SAVE
+    // One frame per packet bypassing the queue (handshake, sender task), client not locked
     esp_err_t sio_send_packet_websocket(sio_client_t *client, const Packet_t *packet);
 #ifdef __cplusplus
 }
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <internal/sio_packet.h>
+#include <esp_types.h>
+#include <esp_err.h>
+
+    typedef void (*sio_stream_packets_cb_t)(PacketPointerArray_t packets, void *ctx);
+
+    // Incremental polling body parser, accepts the body in fragments of any size (content-length or chunked).
+    // Without a callback the packets are collected and end up in `packets` once the body is finished.
+    // With a callback every batch of complete packets is handed over as soon as its delimiter arrived,
+    // the callback owns the array then.
+    typedef struct
+    {
+        PacketPointerArray_t packets; // result when on_packets is NULL, the owner has to free it
+
+        sio_stream_packets_cb_t on_packets;
+        void *on_packets_ctx;
+
+        sio_packet_filter_t filter; // optional, see alloc_packet_arr
+        void *filter_ctx;
+
+        // internal state
+        char *buffer; // pending bytes, starts at the beginning of an incomplete packet
+        size_t len;
+        size_t capacity;
+        size_t scanned;   // bytes of buffer already known to contain no delimiter
+        size_t remaining; // bytes still expected after buffer (content-length), 0 if unknown
+        bool receiving;   // a body is in progress
+
+        uint32_t connections; // connections the http client opened for this stream (HTTP_EVENT_ON_CONNECTED), reset never clears it
+        bool request_sent;    // HTTP_EVENT_HEADER_SENT of the current request, cleared by whoever starts one, not by reset
+        bool response_started; // a header or body byte of the answer arrived, same as request_sent
+    } sio_stream_t;
+
+    // size of the complete body if known (content-length), call before the first fragment, saves reallocations
+    void sio_stream_expect(sio_stream_t *stream, size_t body_len);
+
+    esp_err_t sio_stream_feed(sio_stream_t *stream, const char *data, size_t len);
+
+    // body complete, parses what is left
+    void sio_stream_finish(sio_stream_t *stream);
+
+    // drop a partially received body (does not touch `packets`)
+    void sio_stream_reset(sio_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif
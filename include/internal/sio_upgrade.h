@@ -0,0 +1,19 @@
+#pragma once
+
+#include <sio_client.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Moves a connected polling client to the websocket in the background (client locked):
+    // 2probe / 3probe over a websocket with the session id, polling paused (the server ends the
+    // running poll with a NOOP), then UPGRADE over the websocket. Queued packets follow the transport.
+    // If anything fails the client keeps polling and SIO_EVENT_UPGRADE_TRANSPORT_ERROR is posted.
+    esp_err_t sio_upgrade_start(sio_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
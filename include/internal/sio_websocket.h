@@ -0,0 +1,68 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <internal/sio_packet.h>
+#include <internal/task_functions.h>
+#include <esp_err.h>
+#include <esp_websocket_client.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+// connecting, waiting for the engine.io open packet and sending one frame
+#define SIO_WEBSOCKET_TIMEOUT_MS 5000
+
+    struct sio_client_t;
+
+    typedef enum
+    {
+        SIO_WEBSOCKET_WAIT_NONE = 0,
+        SIO_WEBSOCKET_WAIT_OPEN, // handshake: the engine.io OPEN as first frame
+        SIO_WEBSOCKET_WAIT_PROBE // upgrade: the 3probe answer to our 2probe
+    } sio_websocket_wait_t;
+
+    // Receive side of the websocket transport, only touched by the websocket task while it runs
+    typedef struct
+    {
+        char *frame; // message being received, esp_websocket_client hands it over in pieces
+        size_t frame_len;
+        size_t frame_capacity;
+        bool frame_binary;
+
+        sio_receive_state_t receive;
+
+        sio_websocket_wait_t waiting;      // what the handshake / upgrade waits for
+        PacketPointerArray_t open_packets; // the OPEN once it arrived, taken by the handshake
+        bool probe_answered;               // the server accepted the upgrade
+        SemaphoreHandle_t wait_done;       // given when the awaited frame arrived or the connection failed before
+
+        TimerHandle_t watchdog; // pingInterval + pingTimeout without a PING from the server, created on first use
+        bool watchdog_expired;  // set by the timer, the worker drops the connection. Atomic
+    } sio_websocket_t;
+
+    // Connects the websocket of the client in the background, client locked. Without a session this is a
+    // handshake, the OPEN ends up in open_packets. With one it is an upgrade probe, probe_answered is set
+    // once the server agreed. wait_done is given in both cases.
+    esp_err_t sio_websocket_start(struct sio_client_t *client);
+
+    // Closes and destroys the websocket of the client if it has one. Client NOT locked,
+    // this waits for the websocket task which may need the lock to finish an event.
+    void sio_websocket_stop(struct sio_client_t *client);
+
+    bool sio_websocket_is_connected(struct sio_client_t *client);
+
+    // (Re)starts the watchdog of the session on the websocket, on connect and on every PING of the server.
+    // A server that stays silent for longer counts as a lost connection, even while TCP still looks fine.
+    void sio_websocket_watchdog_feed(struct sio_client_t *client);
+    // Worker, client not locked. The timer only flags the silent server, this closes the websocket and
+    // reconnects (or closes the client) if it expired and was not fed again since.
+    void sio_websocket_watchdog_check(struct sio_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,3 +1,54 @@
 #pragma once
 
-void sio_polling_task(void *pvParameters);
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <sio_types.h>
+#include <internal/sio_packet.h>
+#include <internal/sio_binary.h>
+
+    struct sio_client_t;
+
+    // what the receiving side of a transport keeps between batches of packets
+    typedef struct
+    {
+        sio_client_id_t client_id;
+        sio_binary_assembler_t *binary_assembler;
+        bool close_received; // engine.io CLOSE seen, the transport has to shut down
+        uint8_t attachments_dropped; // still to come of a binary packet sio_namespace_filter dropped
+    } sio_receive_state_t;
+
+    // Handles the engine.io level packets (ping, close) of a batch and posts the messages as
+    // SIO_EVENT_RECEIVED_MESSAGE, takes the array. ctx is a sio_receive_state_t.
+    void sio_handle_packets(PacketPointerArray_t packets, void *ctx);
+
+    // where the polling of a client stands after a step
+    typedef enum
+    {
+        SIO_POLL_CONTINUE = 0, // next poll
+        SIO_POLL_PAUSED,       // the transport upgrade took over, the polling client is gone already
+        SIO_POLL_STOP,         // the client is closing
+        SIO_POLL_LOST          // the poll failed or the server closed, the connection is gone
+    } sio_poll_result_t;
+
+    // The steps of polling a client, driven by its own sio_polling_task or the shared I/O task (sio_io.h).
+    // state has to live until sio_polling_end, the stream of the polling client points to it.
+    uint32_t sio_polling_timeout_ms(const struct sio_client_t *client);
+    void sio_polling_begin(sio_client_id_t clientId, sio_receive_state_t *state, int timeout_ms, bool async);
+    // before every poll
+    sio_poll_result_t sio_polling_next(sio_client_id_t clientId);
+    // after every poll with the result of esp_http_client_perform
+    sio_poll_result_t sio_polling_done(sio_client_id_t clientId, const sio_receive_state_t *state, esp_err_t err);
+    // releases the polling client, posts SIO_EVENT_DISCONNECTED and starts the reconnect for SIO_POLL_LOST
+    void sio_polling_end(sio_client_id_t clientId, sio_poll_result_t result);
+
+    void sio_polling_task(void *pvParameters);
+
+    // drains the outbound queue of a client, see sio_sender_start
+    void sio_sender_task(void *pvParameters);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,23 +8,35 @@ extern "C"
 #include <sio_types.h>
 #include <internal/http_polling_handlers.h>
 #include <internal/sio_packet.h>
+#include <internal/sio_stream.h>
+#include <internal/sio_binary.h>
+#include <internal/sio_websocket.h>
+#include <internal/sio_router.h>
+#include <internal/sio_ack.h>
+#include <internal/sio_reconnect.h>
+#include <internal/sio_namespace.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "esp_event.h"
+#include <cJSON.h>
 
 #define SIO_DEFAULT_EIO_VERSION CONFIG_SIO_DEFAULT_EIO_VERSION
 #define SIO_DEFAULT_SIO_URL_PATH CONFIG_SIO_DEFAULT_SIO_URL_PATH
 
 #define SIO_MAX_PARALLEL_SOCKETS CONFIG_SIO_MAX_PARALLEL_SOCKETS
 #define SIO_DEFAULT_SIO_NAMESPACE CONFIG_SIO_DEFAULT_SIO_NAMESPACE
+#define SIO_DEFAULT_MESSAGE_QUEUE_SIZE CONFIG_SIO_DEFAULT_MESSAGE_QUEUE_SIZE
+
+// engine.io default when the handshake does not say otherwise
+#define SIO_DEFAULT_MAX_PAYLOAD 1000000
 
 #define SIO_TRANSPORT_POLLING_STRING "polling"
 #define SIO_TRANSPORT_POLLING_PROTO_STRING "http"
 
-#define SIO_TRANSPORT_WEBSOCKETS_STRING "websockets"
+#define SIO_TRANSPORT_WEBSOCKETS_STRING "websocket"
 #define SIO_TRANSPORT_WEBSOCKETS_PROTO_STRING "ws"
 
 #define SIO_SID_SIZE 20
@@ -36,6 +48,12 @@ extern "C"
 
     typedef const char *(*sio_auth_body_fptr_t)(const struct sio_client_t *client);
 
+    typedef struct
+    {
+        uint32_t reused;    /* POSTs sent over the kept-alive connection */
+        uint32_t connected; /* POSTs that had to open a new connection first (first one, closed by the server or a proxy) */
+    } sio_post_stats_t;
+
     typedef struct
     {
         uint8_t eio_version;        /* if 0 uses CONFIG_EIO_VERSION */
@@ -51,16 +69,18 @@ extern "C"
     struct sio_client_t
     {
         sio_client_id_t client_id;
-        SemaphoreHandle_t client_lock;
+        SemaphoreHandle_t client_lock; /* Mutex for the fields below, only held for short state changes */
+        SemaphoreHandle_t send_lock;   /* Mutex around posting_client, posting_stream and websocket_client, held for a whole send */
 
-        sio_client_status_t status;
+        sio_client_status_t status; /* Atomic, read with sio_client_get_status, written under client_lock */
 
         uint8_t eio_version;
 
         char *server_address;
         char *sio_url_path;
         char *nspc;
-        sio_transport_t transport;
+        sio_transport_t transport;            /* Transport in use, polling until an upgrade moved it to the websocket */
+        sio_transport_t configured_transport; /* Transport every new handshake starts with */
 
         sio_auth_body_fptr_t alloc_auth_body_cb;
 
@@ -69,38 +89,142 @@ extern "C"
         // info gotten from the server
         uint16_t server_ping_interval_ms; /* Server-configured ping interval */
         uint16_t server_ping_timeout_ms;  /* Server-configured ping wait-timeout */
+        uint32_t server_max_payload;      /* Server-configured max bytes of one polling body */
+        bool server_upgrades_websocket;   /* Server offered the websocket upgrade */
         time_t last_sent_pong;            /* Last time a ping was received */
 
         char *_server_session_id; /* SocketIO session ID */
 
         // used internally
-        esp_http_client_handle_t handshake_client; /* Used to establish first connection*/
-        esp_http_client_handle_t polling_client;   /* Used for continuous polling */
-        esp_http_client_handle_t posting_client;   /* Used for posting messages */
+        esp_http_client_handle_t handshake_client;      /* Used to establish first connection*/
+        esp_http_client_handle_t polling_client;        /* Used for continuous polling */
+        esp_http_client_handle_t posting_client;        /* Used for posting messages */
+        esp_websocket_client_handle_t websocket_client; /* Used for everything with SIO_TRANSPORT_WEBSOCKETS */
+
+        // receive state of the requests above, reached through their user_data
+        // so every client can have a poll and a post in flight at the same time
+        sio_stream_t polling_stream; /* Only touched by the polling task while a poll runs */
+        sio_stream_t posting_stream; /* Only touched by the task holding send_lock */
+        sio_post_stats_t post_stats; /* Counted by the task holding send_lock, atomic */
+        char *post_url;              /* POST url of the session, built with the session under send_lock */
+        char *post_url_token;        /* Cache buster inside post_url, rewritten for every POST */
+        char *poll_url;              /* GET url of the session while polling, built by sio_polling_begin */
+        char *poll_url_token;        /* Cache buster inside poll_url, rewritten for every GET */
+
+        struct sio_outbound_t *outbound_head; /* Lock-free stack of packets for the sender task, newest first */
+        uint16_t outbound_async_count;        /* Async packets queued, at most SIO_DEFAULT_MESSAGE_QUEUE_SIZE */
+        SemaphoreHandle_t outbound_signal;    /* Wakes the sender task */
+        bool sender_running;                  /* The sender task runs, sio_client_destroy waits for it */
+
+        bool polling_paused;  /* The polling task stops after its current poll, the upgrade takes over */
+        bool upgrade_running; /* The upgrade task still uses the client */
+
+        sio_websocket_t websocket; /* Frame reassembly and handshake state of the websocket */
+
+        sio_binary_assembler_t binary_assembler; /* Binary event waiting for attachments, receiving task only */
+
+        sio_router_t router;   /* Handlers registered with sio_on */
+        sio_ack_table_t acks; /* Emits waiting for their ack, under the ack lock shared by all clients */
+
+        sio_reconnect_t reconnect; /* Backoff of the next attempt and the session to recover */
+
+        sio_namespaces_t namespaces; /* Joined with sio_client_join_namespace, share the session */
     };
 
     ESP_EVENT_DECLARE_BASE(SIO_EVENT);
 
     esp_err_t sio_client_begin(const sio_client_id_t clientId);
+    // wakes the worker for a client that wants to start, it sleeps otherwise
+    void sio_worker_notify(const sio_client_id_t clientId);
 
+    // the client stays allocated while it is locked, even if it is destroyed meanwhile
     void unlockClient(sio_client_t *client);
     void lockClient(sio_client_t *client);
 
+    // status can be read without the lock, changing it still needs it so
+    // transitions do not race each other
+    sio_client_status_t sio_client_get_status(const sio_client_t *client);
+    void sio_client_set_status(sio_client_t *client, sio_client_status_t status);
+
     // Init with default values
     sio_client_id_t sio_client_init(const sio_client_config_t *config);
     void sio_client_destroy(sio_client_id_t clientId);
 
     bool sio_client_is_connected(sio_client_id_t clientId);
+    // The server restored the session of the last connection (connection state recovery), events missed
+    // meanwhile are delivered again. false until the servers answer to the connect arrived.
+    bool sio_client_is_recovered(const sio_client_id_t clientId);
+
+    // How often polling POSTs reused the open connection vs. opened a new one
+    esp_err_t sio_client_get_post_stats(sio_client_id_t clientId, sio_post_stats_t *stats);
     esp_err_t sio_client_close(const sio_client_id_t clientId);
 
+    // Block until the POST / frame that carried the packet is done, packet stays with the caller
     esp_err_t sio_send_packet(const sio_client_id_t clientId, const Packet_t *packet);
     esp_err_t sio_send_string(const sio_client_id_t clientId, const char *data);
+
+    // Runs on the clients sender task, do not use the blocking send functions in here
+    typedef void (*sio_send_cb_t)(sio_client_id_t client_id, esp_err_t result, void *ctx);
+
+    // Queue the packet and return right away, the packet is owned (and free'd) by the client from here on,
+    // also if queueing fails. cb (optional) gets the result, failures without a callback are posted as SIO_EVENT_SEND_FAILED.
+    // ESP_ERR_NO_MEM if SIO_DEFAULT_MESSAGE_QUEUE_SIZE packets are already waiting.
+    esp_err_t sio_send_packet_async(const sio_client_id_t clientId, Packet_t *packet, sio_send_cb_t cb, void *ctx);
+    esp_err_t sio_emit_async(const sio_client_id_t clientId, const char *event, const char *json, sio_send_cb_t cb, void *ctx);
+    // sio_emit_async into a namespace joined with sio_client_join_namespace ('42/nsp,["event",json]')
+    esp_err_t sio_emit_to_async(const sio_client_id_t clientId, const char *nsp, const char *event, const char *json, sio_send_cb_t cb, void *ctx);
+
+    // Emits that serialize straight into the outgoing buffer ('42["event",' + arguments + ']'), no json string
+    // of their own. Queued like sio_send_packet_async. The writer runs on the calling task before this returns.
+    esp_err_t sio_emit_writer_async(const sio_client_id_t clientId, const char *event, sio_emit_writer_t writer, void *writer_ctx, sio_send_cb_t cb, void *ctx);
+    esp_err_t sio_emit_event_async(const sio_client_id_t clientId, const sio_event_desc_t *event, sio_emit_writer_t writer, void *writer_ctx, sio_send_cb_t cb, void *ctx);
+    esp_err_t sio_emit_cjson_async(const sio_client_id_t clientId, const char *event, const cJSON *json, sio_send_cb_t cb, void *ctx);
+
+    // Emit '42<id>["event",json]' and call cb once with the servers ack ('43<id>[...]'), after timeout_ms without
+    // one or when the emit could not be sent. At most CONFIG_SIO_ACK_SLOTS acks wait per client (ESP_ERR_NO_MEM).
+    esp_err_t sio_emit_with_ack(const sio_client_id_t clientId, const char *event, const char *json, sio_ack_cb_t cb, void *ctx, uint32_t timeout_ms);
+
+    // writer for a cJSON tree (writer_ctx), printed with cJSON_PrintPreallocated
+    int sio_emit_write_cjson(char *buffer, size_t len, void *json);
+
+    // encodes and escapes the name once, for sio_emit_event_async
+    esp_err_t sio_event_desc_init(sio_event_desc_t *event, const char *name);
+    void sio_event_desc_free(sio_event_desc_t *event);
+
+    // Calls handler for every received event named event instead of posting it as SIO_EVENT_RECEIVED_MESSAGE,
+    // found by a hash of the name without parsing the json. One handler per event, a second sio_on replaces it.
+    // At most CONFIG_SIO_ROUTER_SIZE events per client (ESP_ERR_NO_MEM beyond that).
+    esp_err_t sio_on(const sio_client_id_t clientId, const char *event, sio_on_handler_t handler, void *ctx);
+    // the handler may still run once for an event that was being dispatched while this returned
+    esp_err_t sio_off(const sio_client_id_t clientId, const char *event);
+
+    // Connects the namespace nsp ('/name') over the session the client already has ('40/name,<auth>'), right away if
+    // it is connected and again after every reconnect once the server accepted the main namespace.
+    // Received packets of it carry the name in packet->nsp (handlers of sio_on get its events too), packets of
+    // namespaces nobody joined are dropped before they are parsed. At most CONFIG_SIO_NAMESPACES per client (ESP_ERR_NO_MEM).
+    esp_err_t sio_client_join_namespace(const sio_client_id_t clientId, const char *nsp, sio_auth_body_fptr_t alloc_auth_body_cb);
+    // '41/name,' if it was connected, its packets are dropped from here on. ESP_ERR_NOT_FOUND if it was not joined
+    esp_err_t sio_client_leave_namespace(const sio_client_id_t clientId, const char *nsp);
+    // the server accepted the namespace on the current session
+    bool sio_client_namespace_connected(const sio_client_id_t clientId, const char *nsp);
+
     void sio_client_print_status(const sio_client_id_t clientId);
 
     // locks the semaphore, get it first before doing
     // any writing else it will most certainly produce race conditions
     sio_client_t *sio_client_get_and_lock(const sio_client_id_t clientId);
 
+    // lookup without locking or pinning, only for tasks of the client that sio_client_destroy waits for
+    sio_client_t *sio_client_get(const sio_client_id_t clientId);
+
+    // Lookup without locking for lock-free reads like sio_client_get_status. The client is not free'd before
+    // sio_client_release, a destroy meanwhile only makes later lookups of the id fail.
+    sio_client_t *sio_client_acquire(const sio_client_id_t clientId);
+    void sio_client_release(sio_client_t *client);
+
+    // called once the last reference of a destroyed client is gone
+    void sio_client_free(sio_client_t *client);
+
     bool sio_client_is_locked(const sio_client_id_t clientId);
 
     char *alloc_polling_get_url(const sio_client_t *client);
@@ -11,7 +11,8 @@ extern "C"
 #define CONFIG_LOG_DEFAULT_LEVEL 3
 #endif
 
-    typedef int8_t sio_client_id_t;
+    // a handle (slot and generation, see internal/sio_registry.h), -1 for none
+    typedef int sio_client_id_t;
 
     // low level message
     typedef enum
@@ -37,7 +38,8 @@ extern "C"
         SIO_PACKET_ACK,
         SIO_PACKET_CONNECT_ERROR,
         SIO_PACKET_BINARY_EVENT,
-        SIO_PACKET_BINARY_ACK
+        SIO_PACKET_BINARY_ACK,
+        SIO_PACKET_BINARY_ATTACHMENT // not on the wire, a 'b' frame carrying one attachment of a binary event / ack
     } sio_packet_t;
 
     // events that are given to the outside system
@@ -48,7 +50,8 @@ extern "C"
         SIO_EVENT_RECEIVED_MESSAGE,        /* SocketIO Client received message */
         SIO_EVENT_CONNECT_ERROR,           /* SocketIO Client failed to connect */
         SIO_EVENT_UPGRADE_TRANSPORT_ERROR, /* SocketIO Client failed upgrade transport */
-        SIO_EVENT_DISCONNECTED             /* SocketIO Client disconnected */
+        SIO_EVENT_DISCONNECTED,            /* SocketIO Client disconnected */
+        SIO_EVENT_SEND_FAILED              /* SocketIO Client could not send an async packet that had no callback */
     } sio_event_t;
 
     typedef enum sio_client_status
@@ -69,6 +72,18 @@ extern "C"
         SIO_TRANSPORT_WEBSOCKETS   /* websockets */
     } sio_transport_t;
 
+    // Appends the arguments of an emit (json, comma separated, no closing bracket) to buffer, at most len bytes
+    // including a terminator. Returns the length it needs without the terminator, so >= len means it did not fit
+    // and it is called again with that much room. < 0 fails the emit. Same contract as snprintf.
+    typedef int (*sio_emit_writer_t)(char *buffer, size_t len, void *ctx);
+
+    // Event name encoded once ('42["name",' with the name escaped) for emits that happen often
+    typedef struct
+    {
+        char *header;
+        size_t header_len;
+    } sio_event_desc_t;
+
     // http structs
 
 #ifdef __cplusplus
@@ -12,9 +12,11 @@ extern "C"
 #include "esp_log.h"
 #include "esp_err.h"
 
-    char *alloc_random_string(const size_t length);
     void freeIfNotNull(void **ptr);
 
+    // SIO_TOKEN_SIZE chars of a new cache buster (t=), no terminator
+    void sio_write_token(char *token);
+
     // undef
 
     char *util_str_cat(char *destination, char *source);
@@ -28,9 +30,15 @@ extern "C"
 
     char *util_extract_json(char *pcBuffer);
 
-    char *alloc_post_url(const sio_client_t *client);
     char *alloc_handshake_get_url(const sio_client_t *client);
 
+    // polling url of the session (with sid), token_out (optional) points at its t= token
+    // so later requests can refresh it in place with sio_write_token
+    char *alloc_session_url(const sio_client_t *client, char **token_out);
+
+    // ws:// url of the engine.io websocket endpoint, with the session id if the client has one
+    char *alloc_websocket_url(const sio_client_t *client);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
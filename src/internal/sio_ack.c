@@ -0,0 +1,372 @@
+#include <internal/sio_ack.h>
+#include <sio_client.h>
+
+#include <esp_log.h>
+
+static const char *TAG = "[sio_ack]";
+
+// callbacks run without the lock, this many are copied out at a time
+#define SIO_ACK_CALL_BATCH 8
+
+// guards the ack tables of all clients and the wheel
+static SemaphoreHandle_t ack_lock = NULL;
+static SemaphoreHandle_t ack_signal = NULL; // wakes the idle ack task
+static TaskHandle_t ack_task = NULL;
+
+static sio_ack_t *wheel[SIO_ACK_WHEEL_SLOTS];
+static uint32_t wheel_now = 0;     // ticks the wheel turned, only while acks were waiting
+static uint32_t wheel_pending = 0; // acks on the wheel
+
+// ack lock held for all of these
+
+static void wheel_link(sio_ack_t *ack)
+{
+    sio_ack_t **slot = &wheel[ack->expires % SIO_ACK_WHEEL_SLOTS];
+    ack->prev = NULL;
+    ack->next = *slot;
+    if (*slot != NULL)
+    {
+        (*slot)->prev = ack;
+    }
+    *slot = ack;
+}
+
+static void wheel_unlink(sio_ack_t *ack)
+{
+    if (ack->prev != NULL)
+    {
+        ack->prev->next = ack->next;
+    }
+    else
+    {
+        wheel[ack->expires % SIO_ACK_WHEEL_SLOTS] = ack->next;
+    }
+    if (ack->next != NULL)
+    {
+        ack->next->prev = ack->prev;
+    }
+    ack->next = NULL;
+    ack->prev = NULL;
+}
+
+static sio_ack_t *ack_find(sio_ack_table_t *table, uint32_t id)
+{
+    sio_ack_t *ack = &table->slots[id % CONFIG_SIO_ACK_SLOTS];
+    return ack->pending && ack->id == id ? ack : NULL;
+}
+
+static void ack_take(sio_ack_t *ack)
+{
+    wheel_unlink(ack);
+    ack->pending = false;
+    __atomic_store_n(&wheel_pending, wheel_pending - 1, __ATOMIC_RELAXED);
+}
+
+// Times out the acks of the slot the wheel just reached. The later ones sharing the slot wait for another turn.
+static void wheel_advance(void)
+{
+    xSemaphoreTake(ack_lock, portMAX_DELAY);
+    uint32_t now = ++wheel_now;
+    xSemaphoreGive(ack_lock);
+
+    size_t count;
+    do
+    {
+        sio_ack_t expired[SIO_ACK_CALL_BATCH];
+        count = 0;
+
+        xSemaphoreTake(ack_lock, portMAX_DELAY);
+        sio_ack_t *ack = wheel[now % SIO_ACK_WHEEL_SLOTS];
+        while (ack != NULL && count < SIO_ACK_CALL_BATCH)
+        {
+            sio_ack_t *next = ack->next;
+            if ((int32_t)(now - ack->expires) >= 0)
+            {
+                expired[count++] = *ack;
+                ack_take(ack);
+            }
+            ack = next;
+        }
+        xSemaphoreGive(ack_lock);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            ESP_LOGD(TAG, "Ack %lu of client %d timed out", (unsigned long)expired[i].id, expired[i].client_id);
+            expired[i].cb(expired[i].client_id, ESP_ERR_TIMEOUT, NULL, NULL, 0, expired[i].ctx);
+        }
+    } while (count == SIO_ACK_CALL_BATCH);
+}
+
+// turns the wheel while acks are waiting, sleeps otherwise
+static void sio_ack_task(void *pvParameters)
+{
+    TickType_t last_tick = xTaskGetTickCount();
+
+    while (true)
+    {
+        if (__atomic_load_n(&wheel_pending, __ATOMIC_RELAXED) == 0)
+        {
+            xSemaphoreTake(ack_signal, portMAX_DELAY);
+            last_tick = xTaskGetTickCount();
+            continue;
+        }
+
+        vTaskDelayUntil(&last_tick, pdMS_TO_TICKS(SIO_ACK_WHEEL_TICK_MS));
+        wheel_advance();
+    }
+}
+
+esp_err_t sio_ack_init(void)
+{
+    if (ack_lock != NULL)
+    {
+        return ESP_OK;
+    }
+
+    ack_lock = xSemaphoreCreateMutex();
+    ack_signal = xSemaphoreCreateBinary();
+    if (ack_lock == NULL || ack_signal == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create the ack lock");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sio_ack_add(sio_ack_table_t *table, sio_client_id_t client_id, sio_ack_cb_t cb, void *ctx, uint32_t timeout_ms, uint32_t *id)
+{
+    // never early: the wheel may be just about to tick when the ack is added
+    uint32_t ticks = (timeout_ms + SIO_ACK_WHEEL_TICK_MS - 1) / SIO_ACK_WHEEL_TICK_MS + 1;
+
+    xSemaphoreTake(ack_lock, portMAX_DELAY);
+
+    if (ack_task == NULL &&
+        xTaskCreate(&sio_ack_task, "sio_ack", 4096, NULL, 5, &ack_task) != pdPASS)
+    {
+        ack_task = NULL;
+        xSemaphoreGive(ack_lock);
+        ESP_LOGE(TAG, "Failed to start the ack task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // ids keep counting up (socket.io wants them positive), one whose slot is still waiting is skipped
+    sio_ack_t *ack = NULL;
+    uint32_t candidate = table->next_id;
+    for (size_t tries = 0; tries < CONFIG_SIO_ACK_SLOTS; tries++)
+    {
+        sio_ack_t *slot = &table->slots[candidate % CONFIG_SIO_ACK_SLOTS];
+        if (!slot->pending)
+        {
+            ack = slot;
+            ack->id = candidate;
+            table->next_id = (candidate + 1) & INT32_MAX;
+            break;
+        }
+        candidate = (candidate + 1) & INT32_MAX;
+    }
+
+    if (ack == NULL)
+    {
+        xSemaphoreGive(ack_lock);
+        ESP_LOGW(TAG, "All %d acks of client %d are waiting", CONFIG_SIO_ACK_SLOTS, client_id);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ack->pending = true;
+    ack->client_id = client_id;
+    ack->cb = cb;
+    ack->ctx = ctx;
+    ack->expires = wheel_now + ticks;
+    wheel_link(ack);
+    __atomic_store_n(&wheel_pending, wheel_pending + 1, __ATOMIC_RELAXED);
+    *id = ack->id;
+
+    xSemaphoreGive(ack_lock);
+    xSemaphoreGive(ack_signal);
+    return ESP_OK;
+}
+
+void sio_ack_remove(sio_ack_table_t *table, uint32_t id)
+{
+    xSemaphoreTake(ack_lock, portMAX_DELAY);
+    sio_ack_t *ack = ack_find(table, id);
+    if (ack != NULL)
+    {
+        ack_take(ack);
+    }
+    xSemaphoreGive(ack_lock);
+}
+
+void sio_ack_fail(sio_ack_table_t *table, uint32_t id, esp_err_t result)
+{
+    xSemaphoreTake(ack_lock, portMAX_DELAY);
+    sio_ack_t *found = ack_find(table, id);
+    sio_ack_t ack;
+    if (found != NULL)
+    {
+        ack = *found;
+        ack_take(found);
+    }
+    xSemaphoreGive(ack_lock);
+
+    if (found != NULL)
+    {
+        ack.cb(ack.client_id, result, NULL, NULL, 0, ack.ctx);
+    }
+}
+
+void sio_ack_cancel_all(sio_ack_table_t *table)
+{
+    if (ack_lock == NULL)
+    {
+        return;
+    }
+
+    size_t count;
+    do
+    {
+        sio_ack_t cancelled[SIO_ACK_CALL_BATCH];
+        count = 0;
+
+        xSemaphoreTake(ack_lock, portMAX_DELAY);
+        for (size_t i = 0; i < CONFIG_SIO_ACK_SLOTS && count < SIO_ACK_CALL_BATCH; i++)
+        {
+            if (table->slots[i].pending)
+            {
+                cancelled[count++] = table->slots[i];
+                ack_take(&table->slots[i]);
+            }
+        }
+        xSemaphoreGive(ack_lock);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            cancelled[i].cb(cancelled[i].client_id, ESP_ERR_INVALID_STATE, NULL, NULL, 0, cancelled[i].ctx);
+        }
+    } while (count == SIO_ACK_CALL_BATCH);
+}
+
+static bool is_json_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void sio_ack_dispatch(sio_client_id_t client_id, PacketPointerArray_t packets)
+{
+    if (__atomic_load_n(&wheel_pending, __ATOMIC_RELAXED) == 0)
+    {
+        return;
+    }
+    sio_client_t *client = sio_client_acquire(client_id);
+    if (client == NULL)
+    {
+        return;
+    }
+
+    size_t out = 0;
+    for (size_t in = 0; packets[in] != NULL; in++)
+    {
+        Packet_t *packet = packets[in];
+
+        if (packet->eio_type != EIO_PACKET_MESSAGE ||
+            (packet->sio_type != SIO_PACKET_ACK && packet->sio_type != SIO_PACKET_BINARY_ACK) ||
+            packet->ack_id < 0 || packet->json_start == NULL || *packet->json_start != '[' || packet->nsp != NULL)
+        {
+            packets[out++] = packet;
+            continue;
+        }
+
+        xSemaphoreTake(ack_lock, portMAX_DELAY);
+        sio_ack_t *found = ack_find(&client->acks, packet->ack_id);
+        sio_ack_t ack;
+        if (found != NULL)
+        {
+            ack = *found;
+            ack_take(found);
+        }
+        xSemaphoreGive(ack_lock);
+
+        if (found == NULL)
+        {
+            ESP_LOGD(TAG, "Nobody waits for ack %ld anymore", (long)packet->ack_id);
+            packets[out++] = packet;
+            continue;
+        }
+
+        // the array without its brackets
+        const char *args = packet->json_start + 1;
+        const char *last = packet->data + packet->len;
+        while (last > args && is_json_space(last[-1]))
+        {
+            last--;
+        }
+        if (last > args && last[-1] == ']')
+        {
+            last--;
+        }
+        while (last > args && is_json_space(last[-1]))
+        {
+            last--;
+        }
+
+        ack.cb(client_id, ESP_OK, packet, args, last - args, ack.ctx);
+        free_packet(&packet);
+    }
+
+    packets[out] = NULL;
+    sio_client_release(client);
+}
+
+// runs on the sender task, an emit that did not go out will not be acknowledged either
+static void ack_emit_sent(sio_client_id_t client_id, esp_err_t result, void *ctx)
+{
+    if (result == ESP_OK)
+    {
+        return;
+    }
+
+    sio_client_t *client = sio_client_acquire(client_id);
+    if (client != NULL)
+    {
+        sio_ack_fail(&client->acks, (uint32_t)(uintptr_t)ctx, result);
+        sio_client_release(client);
+    }
+}
+
+esp_err_t sio_emit_with_ack(const sio_client_id_t clientId, const char *event, const char *json, sio_ack_cb_t cb, void *ctx, uint32_t timeout_ms)
+{
+    if (event == NULL || cb == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t id;
+    esp_err_t err = sio_ack_add(&client->acks, clientId, cb, ctx, timeout_ms, &id);
+    if (err != ESP_OK)
+    {
+        sio_client_release(client);
+        return err;
+    }
+
+    Packet_t *packet = alloc_ack_message(json, event, id);
+    if (packet == NULL)
+    {
+        sio_ack_remove(&client->acks, id);
+        sio_client_release(client);
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = sio_send_packet_async(clientId, packet, ack_emit_sent, (void *)(uintptr_t)id);
+    if (err != ESP_OK)
+    {
+        sio_ack_remove(&client->acks, id);
+    }
+    sio_client_release(client);
+    return err;
+}
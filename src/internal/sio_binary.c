@@ -0,0 +1,76 @@
+#include <internal/sio_binary.h>
+
+#include <esp_log.h>
+#include <stdlib.h>
+
+static const char *TAG = "[sio_binary]";
+
+static bool is_binary_header(const Packet_t *packet)
+{
+    return packet->eio_type == EIO_PACKET_MESSAGE &&
+           (packet->sio_type == SIO_PACKET_BINARY_EVENT || packet->sio_type == SIO_PACKET_BINARY_ACK) &&
+           packet->attachment_count > 0;
+}
+
+void sio_binary_assemble(sio_binary_assembler_t *assembler, PacketPointerArray_t packets)
+{
+    size_t out = 0;
+
+    for (size_t in = 0; packets[in] != NULL; in++)
+    {
+        Packet_t *packet = packets[in];
+
+        if (packet->sio_type == SIO_PACKET_BINARY_ATTACHMENT)
+        {
+            Packet_t *header = assembler->pending;
+            if (header == NULL)
+            {
+                ESP_LOGW(TAG, "Binary packet without a header, passing it on as is");
+                packets[out++] = packet;
+                continue;
+            }
+
+            // the attachment stays in its batch, the header just holds the reference now
+            header->attachments[header->attachments_received++] = packet;
+            if (header->attachments_received == header->attachment_count)
+            {
+                assembler->pending = NULL;
+                packets[out++] = header;
+            }
+            continue;
+        }
+
+        if (is_binary_header(packet))
+        {
+            if (assembler->pending != NULL)
+            {
+                ESP_LOGW(TAG, "Binary event with %d/%d attachments replaced by a new one",
+                         assembler->pending->attachments_received, assembler->pending->attachment_count);
+                free_packet(&assembler->pending);
+            }
+
+            packet->attachments = (Packet_t **)calloc(packet->attachment_count, sizeof(Packet_t *));
+            if (packet->attachments == NULL)
+            {
+                ESP_LOGE(TAG, "Failed to allocate %d attachments, dropping binary event", packet->attachment_count);
+                free_packet(&packet);
+                continue;
+            }
+
+            assembler->pending = packet;
+            continue;
+        }
+
+        packets[out++] = packet;
+    }
+
+    packets[out] = NULL;
+}
+
+void sio_binary_assembler_reset(sio_binary_assembler_t *assembler)
+{
+    if (assembler->pending != NULL)
+    {
+        free_packet(&assembler->pending);
+    }
+}
@@ -4,27 +4,47 @@
 #include <internal/task_functions.h>
 #include <utility.h>
 #include <internal/sio_connect.h>
+#include <internal/sio_send.h>
+#include <internal/sio_upgrade.h>
+#include <internal/sio_io.h>
 
 esp_err_t sio_connect(sio_client_t *client)
 {
-    assert(client->status == SIO_CLIENT_STATUS_HANDSHOOK && "Client did not sio_handshake?");
+    assert(sio_client_get_status(client) == SIO_CLIENT_STATUS_HANDSHOOK && "Client did not sio_handshake?");
 
     esp_err_t err = ESP_FAIL;
 
     if (client->transport == SIO_TRANSPORT_WEBSOCKETS)
     {
-        assert(false && "Websockets not implemented yet");
+        // the websocket task receives, the sender only has to run for outgoing packets.
+        // A drop after this check finds the client connected and closes it again.
+        err = sio_websocket_is_connected(client) ? sio_sender_start(client) : ESP_FAIL;
     }
     else if (client->transport == SIO_TRANSPORT_POLLING)
     {
-
-        xTaskCreate(&sio_polling_task, "sio_polling", 4096, (void *)client->client_id, 6, NULL);
-        err = ESP_OK;
+#if CONFIG_SIO_IO_TASK
+        // polls on the shared I/O task, so does the sender
+        err = sio_io_add_polling(client->client_id);
+        if (err == ESP_OK)
+        {
+            err = sio_sender_start(client);
+        }
+#else
+        xTaskCreate(&sio_polling_task, "sio_polling", 4096, (void *)(intptr_t)client->client_id, 6, NULL);
+        err = sio_sender_start(client);
+#endif
+#if CONFIG_SIO_UPGRADE_TRANSPORT
+        if (err == ESP_OK && client->server_upgrades_websocket)
+        {
+            // runs once the client is connected, a failed upgrade keeps polling
+            sio_upgrade_start(client);
+        }
+#endif
     }
 
     if (err != ESP_OK)
     {
-        client->status = SIO_CLIENT_STATUS_ERROR;
+        sio_client_set_status(client, SIO_CLIENT_STATUS_ERROR);
     }
     else
     {
@@ -34,7 +54,7 @@ esp_err_t sio_connect(sio_client_t *client)
             .len = 0};
         esp_event_post(SIO_EVENT, SIO_EVENT_CONNECTED, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
 
-        client->status = SIO_CLIENT_STATUS_CONNECTED;
+        sio_client_set_status(client, SIO_CLIENT_STATUS_CONNECTED);
     }
 
     return err;
@@ -3,9 +3,10 @@
 #include <internal/sio_packet.h>
 #include <internal/task_functions.h>
 #include <utility.h>
-#include <cJSON.h>
+#include <internal/sio_json.h>
 #include <internal/sio_handshake.h>
 #include <internal/sio_send.h>
+#include <internal/sio_stream.h>
 
 #include <esp_log.h>
 
@@ -14,10 +15,123 @@ esp_err_t handshake_websocket(sio_client_t *client);
 
 static const char *TAG = "[sio_handshake]";
 
+// sid, upgrades (+ each entry), pingInterval, pingTimeout, maxPayload and what servers may add
+#define SIO_HANDSHAKE_JSON_TOKENS 32
+
+// session id, ping timing and max payload from the engine.io OPEN, client locked
+static esp_err_t handshake_read_open(sio_client_t *client, const Packet_t *packet)
+{
+    if (packet->eio_type != EIO_PACKET_OPEN)
+    {
+        ESP_LOGE(TAG, "Expected open packet, got %d", packet->eio_type);
+        return ESP_FAIL;
+    }
+
+    // the OPEN is a flat object of about a dozen values
+    sio_json_token_t tokens[SIO_HANDSHAKE_JSON_TOKENS];
+    sio_json_t json;
+    esp_err_t err = sio_json_parse_packet(&json, packet, tokens, SIO_HANDSHAKE_JSON_TOKENS);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to parse handshake JSON: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Handshake json %.*s", tokens[0].end - tokens[0].start, json.data + tokens[0].start);
+
+    const char *sid;
+    size_t sid_len;
+    int32_t ping_interval, ping_timeout;
+    if (!sio_json_string(&json, sio_json_find(&json, "sid"), &sid, &sid_len) ||
+        sio_json_int(&json, sio_json_find(&json, "pingInterval"), &ping_interval) != ESP_OK ||
+        sio_json_int(&json, sio_json_find(&json, "pingTimeout"), &ping_timeout) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Handshake without sid, pingInterval or pingTimeout");
+        return ESP_FAIL;
+    }
+
+    freeIfNotNull((void **)&client->_server_session_id);
+    client->_server_session_id = strndup(sid, sid_len);
+
+    // the POSTs of the session only refresh its token from here on
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    freeIfNotNull((void **)&client->post_url);
+    client->post_url = alloc_session_url(client, &client->post_url_token);
+    xSemaphoreGive(client->send_lock);
+    client->server_ping_interval_ms = ping_interval;
+    client->server_ping_timeout_ms = ping_timeout;
+
+    double max_payload;
+    client->server_max_payload = sio_json_number(&json, sio_json_find(&json, "maxPayload"), &max_payload) == ESP_OK
+                                     ? (uint32_t)max_payload
+                                     : SIO_DEFAULT_MAX_PAYLOAD;
+
+    const sio_json_token_t *upgrades = sio_json_find(&json, "upgrades");
+    client->server_upgrades_websocket = false;
+    for (int i = 0; upgrades != NULL && i < upgrades->size; i++)
+    {
+        if (sio_json_equals(&json, sio_json_at(&json, upgrades, i), SIO_TRANSPORT_WEBSOCKETS_STRING))
+        {
+            client->server_upgrades_websocket = true;
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Post an OK, or rather the auth message, over the transport of the client. Client locked.
+static esp_err_t handshake_send_connect(sio_client_t *client)
+{
+    const char *auth_data = client->alloc_auth_body_cb == NULL ? strdup("") : client->alloc_auth_body_cb(client);
+
+    // asks the server to restore the last session and replay what was missed since its offset
+    char *recovery = sio_recovery_alloc_auth(&client->reconnect, auth_data);
+    if (recovery != NULL)
+    {
+        free((void *)auth_data);
+        auth_data = recovery;
+    }
+
+    Packet_t *init_packet = alloc_message(auth_data, NULL);
+    free((void *)auth_data);
+    auth_data = NULL;
+
+    setSioType(init_packet, SIO_PACKET_CONNECT);
+
+    esp_err_t err = ESP_FAIL;
+    if (client->transport == SIO_TRANSPORT_POLLING)
+    {
+        err = sio_send_packet_polling(client, init_packet);
+    }
+    else if (client->transport == SIO_TRANSPORT_WEBSOCKETS)
+    {
+        unlockClient(client);
+        err = sio_send_packet_websocket(client, init_packet);
+        lockClient(client);
+    }
+    else
+    {
+        assert(false && "Unknown transport");
+    }
+
+    ESP_LOGI(TAG, "free init packet");
+    free_packet(&init_packet);
+
+    return err;
+}
+
 esp_err_t sio_handshake(sio_client_t *client)
 {
-    assert(client->status != SIO_CLIENT_STATUS_HANDSHAKING && "Client is already handshaking");
-    client->status = SIO_CLIENT_STATUS_HANDSHAKING;
+    assert(sio_client_get_status(client) != SIO_CLIENT_STATUS_HANDSHAKING && "Client is already handshaking");
+    sio_client_set_status(client, SIO_CLIENT_STATUS_HANDSHAKING);
+
+    // a new handshake starts a new session, the old id must not end up in the urls
+    freeIfNotNull((void **)&client->_server_session_id);
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    freeIfNotNull((void **)&client->post_url);
+    xSemaphoreGive(client->send_lock);
+    client->transport = client->configured_transport;
+    client->polling_paused = false;
+    sio_namespace_reset(&client->namespaces);
 
     esp_err_t err = ESP_FAIL;
 
@@ -38,7 +152,7 @@ esp_err_t sio_handshake(sio_client_t *client)
 
     if (err != ESP_OK)
     {
-        client->status = SIO_CLIENT_STATUS_ERROR;
+        sio_client_set_status(client, SIO_CLIENT_STATUS_ERROR);
 
         ESP_LOGW(TAG, "Handshake failed, sending error event");
         sio_event_data_t event_data = {
@@ -49,7 +163,7 @@ esp_err_t sio_handshake(sio_client_t *client)
     }
     else
     {
-        client->status = SIO_CLIENT_STATUS_HANDSHOOK;
+        sio_client_set_status(client, SIO_CLIENT_STATUS_HANDSHOOK);
     }
 
     return err;
@@ -57,11 +171,8 @@ esp_err_t sio_handshake(sio_client_t *client)
 
 esp_err_t handshake_polling(sio_client_t *client)
 {
-
-    const sio_client_id_t client_id = client->client_id;
-
-    static PacketPointerArray_t packets;
-    packets = NULL;
+    // the handshake client does not outlive this function, neither does its stream
+    sio_stream_t stream = {0};
     // scope for first url without session id
 
     assert(client->handshake_client == NULL && "Handshake client already exists");
@@ -77,7 +188,7 @@ esp_err_t handshake_polling(sio_client_t *client)
             .method = HTTP_METHOD_GET,
             .disable_auto_redirect = true,
             .event_handler = http_client_polling_get_handler,
-            .user_data = &packets,
+            .user_data = &stream,
             .timeout_ms = 5000};
 
         client->handshake_client = esp_http_client_init(&config);
@@ -93,14 +204,17 @@ esp_err_t handshake_polling(sio_client_t *client)
 
     esp_err_t err = ESP_FAIL;
     {
-    retry_handshake:
-        sio_client_status_t client_status = client->status;
+        sio_client_status_t client_status = sio_client_get_status(client);
         esp_http_client_handle_t client_handshake_http_client = client->handshake_client;
 
         if (client_status != SIO_CLIENT_STATUS_HANDSHAKING)
         {
             ESP_LOGW(TAG, "Handshake cancelled, client status is %d", client_status);
             esp_http_client_close(client->handshake_client);
+            // user_data points into this stack frame, the http client must not outlive it
+            esp_http_client_cleanup(client->handshake_client);
+            client->handshake_client = NULL;
+            sio_stream_reset(&stream);
 
             return ESP_ERR_INVALID_STATE;
         }
@@ -108,30 +222,30 @@ esp_err_t handshake_polling(sio_client_t *client)
         ESP_LOGI(TAG, "Sending sio_handshake status: %d", client_status);
         assert(client_handshake_http_client != NULL);
 
-        // UNSAFE START
+        // the worker keeps the client pinned, a close meanwhile shows in the status
         unlockClient(client);
-        client = NULL;
         err = esp_http_client_perform(client_handshake_http_client);
-        client = sio_client_get_and_lock(client_id);
-        // UNSAFE END
-
-        if (err != ESP_OK)
-        {
-            ESP_LOGW(TAG, "Handshake failed, retrying: %s ", esp_err_to_name(err));
-
-            goto retry_handshake;
-        }
+        lockClient(client);
 
         esp_http_client_close(client_handshake_http_client);
         esp_http_client_cleanup(client_handshake_http_client);
         client->handshake_client = NULL;
+        sio_stream_reset(&stream);
     }
     { // scope for var declaration error after cleanup
 
+        PacketPointerArray_t packets = stream.packets;
+        stream.packets = NULL;
+
+        // no retry here, the worker tries again after a backoff
         if (err != ESP_OK || packets == NULL)
         {
             ESP_LOGE(TAG, "HTTP GET request failed: %s, packets pointer %p ", esp_err_to_name(err), packets);
-            return err;
+            if (packets != NULL)
+            {
+                free_packet_arr(&packets);
+            }
+            return err == ESP_OK ? ESP_FAIL : err;
         }
 
         // parse the packet to get out session id and reconnect stuff etc
@@ -139,76 +253,78 @@ esp_err_t handshake_polling(sio_client_t *client)
         if (get_array_size(packets) != 1)
         {
             ESP_LOGE(TAG, "Expected 1 packet, got %d", get_array_size(packets));
+            free_packet_arr(&packets);
             return ESP_FAIL;
         }
 
-        Packet_t *packet = packets[0];
-
-        if (packet->eio_type != EIO_PACKET_OPEN)
-        {
-            ESP_LOGE(TAG, "Expected open packet, got %d", packet->eio_type);
-            return ESP_FAIL;
-        }
+        err = handshake_read_open(client, packets[0]);
+        free_packet_arr(&packets);
+    }
 
-        cJSON *json = cJSON_Parse(packet->json_start);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
 
-        if (json == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to parse JSON: %s", cJSON_GetErrorPtr());
-            const char *error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr != NULL)
-            {
-                fprintf(stderr, "Error before: %s\n", error_ptr);
-            }
+    // send back the ok with the new url
+    return handshake_send_connect(client);
+}
 
-            return ESP_FAIL;
-        }
-        else
-        {
-            char *json_printed = cJSON_Print(json);
-            ESP_LOGI(TAG, "Handshake json %s", json_printed);
-            free(json_printed);
-        }
+esp_err_t handshake_websocket(sio_client_t *client)
+{
+    sio_websocket_t *ws = &client->websocket;
 
-        client->_server_session_id = strdup(cJSON_GetObjectItemCaseSensitive(json, "sid")->valuestring);
-        client->server_ping_interval_ms = cJSON_GetObjectItem(json, "pingInterval")->valueint;
-        client->server_ping_timeout_ms = cJSON_GetObjectItem(json, "pingTimeout")->valueint;
+    // one the server dropped earlier is still around
+    unlockClient(client);
+    sio_websocket_stop(client);
+    lockClient(client);
 
-        cJSON_Delete(json);
-        // send back the ok with the new url
+    esp_err_t err = sio_websocket_start(client);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
 
-        // Post an OK, or rather the auth message
+    // the server opens the session with its first frame
+    unlockClient(client);
+    bool opened = xSemaphoreTake(ws->wait_done, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS)) == pdTRUE;
+    lockClient(client);
 
-        const char *auth_data = client->alloc_auth_body_cb == NULL ? strdup("") : client->alloc_auth_body_cb(client);
+    PacketPointerArray_t packets = opened ? ws->open_packets : NULL;
+    ws->open_packets = NULL;
 
-        Packet_t *init_packet = alloc_message(auth_data, NULL);
-        free((void *)auth_data);
-        auth_data = NULL;
+    if (sio_client_get_status(client) != SIO_CLIENT_STATUS_HANDSHAKING)
+    {
+        ESP_LOGW(TAG, "Handshake cancelled, client status is %d", sio_client_get_status(client));
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else if (packets == NULL)
+    {
+        ESP_LOGE(TAG, "No open packet over the websocket");
+        err = ESP_FAIL;
+    }
+    else if ((err = handshake_read_open(client, packets[0])) == ESP_OK)
+    {
+        // from here the server has to ping within its interval
+        sio_websocket_watchdog_feed(client);
+    }
 
-        setSioType(init_packet, SIO_PACKET_CONNECT);
+    if (packets != NULL)
+    {
+        free_packet_arr(&packets);
+    }
 
-        if (client->transport == SIO_TRANSPORT_POLLING)
-        {
-            err = sio_send_packet_polling(client, init_packet);
-        }
-        else if (client->transport == SIO_TRANSPORT_WEBSOCKETS)
-        {
-            err = sio_send_packet_websocket(client, init_packet);
-        }
-        else
-        {
-            assert(false && "Unknown transport");
-        }
+    if (err == ESP_OK)
+    {
+        err = handshake_send_connect(client);
+    }
 
-        ESP_LOGI(TAG, "free init packet");
-        free_packet(&init_packet);
+    if (err != ESP_OK)
+    {
+        unlockClient(client);
+        sio_websocket_stop(client);
+        lockClient(client);
     }
 
     return err;
 }
-
-esp_err_t handshake_websocket(sio_client_t *client)
-{
-    assert(false && "Not implemented");
-    return ESP_FAIL;
-}
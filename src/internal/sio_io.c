@@ -0,0 +1,216 @@
+#include <internal/sio_io.h>
+#include <internal/sio_send.h>
+#include <internal/task_functions.h>
+#include <internal/sio_registry.h>
+#include <sio_client.h>
+#include <utility.h>
+
+#include <esp_log.h>
+#include <stdlib.h>
+
+static const char *TAG = "[sio_io]";
+
+static TaskHandle_t io_task = NULL;
+
+#if CONFIG_SIO_IO_TASK
+
+// an idle task still looks at its senders this often, they stop once their client is closed
+#define SIO_IO_IDLE_CHECK_MS 1000
+
+// set by the tasks handing a client over, picked up at the start of the next round
+#define SIO_IO_ADD_POLLING 0x1
+#define SIO_IO_ADD_SENDER 0x2
+
+typedef struct
+{
+    uint8_t added; // SIO_IO_ADD_*, atomic
+
+    bool polling;
+    bool in_flight;              // the GET of the current poll is still running
+    TickType_t deadline;         // the running poll counts as timed out from here on
+    sio_receive_state_t receive; // the polling stream points here while polling
+
+    bool sending;
+    sio_sender_t sender; // what is left and the POST on its way, carried over between rounds
+} sio_io_slot_t;
+
+// by registry slot, allocated with the task. Only touched by the I/O task apart from added
+static sio_io_slot_t *io_slots = NULL;
+
+// one step of the clients poll: starts the next GET or gives the running one its slice, client pinned
+static void io_poll_step(sio_client_t *client, sio_io_slot_t *slot)
+{
+    sio_client_id_t clientId = client->client_id;
+    sio_poll_result_t result;
+
+    if (!slot->in_flight)
+    {
+        if ((result = sio_polling_next(clientId)) != SIO_POLL_CONTINUE)
+        {
+            goto end;
+        }
+        slot->deadline = xTaskGetTickCount() + pdMS_TO_TICKS(sio_polling_timeout_ms(client));
+        slot->in_flight = true;
+
+        // same url as the last GET, just a new cache buster
+        sio_write_token(client->poll_url_token);
+        esp_http_client_set_url(client->polling_client, client->poll_url);
+    }
+    else if (sio_client_get_status(client) != SIO_CLIENT_STATUS_CONNECTED)
+    {
+        // closing, no need to wait for the server to end the poll
+        result = SIO_POLL_STOP;
+        goto end;
+    }
+
+    // packets are handled by sio_handle_packets as they come in, EAGAIN while the response is not complete
+    esp_err_t err = esp_http_client_perform(client->polling_client);
+    if (err == ESP_ERR_HTTP_EAGAIN)
+    {
+        if ((int32_t)(xTaskGetTickCount() - slot->deadline) < 0)
+        {
+            return;
+        }
+        err = ESP_ERR_TIMEOUT;
+    }
+    slot->in_flight = false;
+
+    if ((result = sio_polling_done(clientId, &slot->receive, err)) == SIO_POLL_CONTINUE)
+    {
+        return;
+    }
+
+end:
+    sio_polling_end(clientId, result);
+    slot->polling = false;
+    slot->in_flight = false;
+}
+
+static void sio_io_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Started the I/O task");
+
+    while (true)
+    {
+        bool polling = false;
+        bool sending = false;
+
+        for (size_t index = 0; index < sio_registry_slots(); index++)
+        {
+            sio_io_slot_t *slot = &io_slots[index];
+            uint8_t added = __atomic_exchange_n(&slot->added, 0, __ATOMIC_ACQUIRE);
+            // pinned for the round, a destroy meanwhile only ends it
+            sio_client_t *client = sio_client_acquire(sio_registry_id_at(index));
+
+            if (client == NULL)
+            {
+                // destroyed before its first round
+                continue;
+            }
+            sio_client_id_t clientId = client->client_id;
+
+            if (added & SIO_IO_ADD_POLLING)
+            {
+                sio_polling_begin(clientId, &slot->receive, CONFIG_SIO_IO_SLICE_MS, true);
+                slot->polling = true;
+                slot->in_flight = false;
+            }
+            if (added & SIO_IO_ADD_SENDER)
+            {
+                slot->sending = true;
+            }
+
+            if (slot->polling)
+            {
+                io_poll_step(client, slot);
+            }
+            if (slot->sending)
+            {
+                // false once the client is closed and nothing is left, sender_running dropped with it
+                slot->sending = sio_sender_round(client, &slot->sender);
+            }
+            sio_client_release(client);
+
+            // a POST on its way wants its next slice like a poll does
+            polling |= slot->polling || slot->sender.post.batch != NULL;
+            sending |= slot->sending;
+        }
+
+        // the polls waited for their slices already, the tick only keeps a round of instant EAGAINs from
+        // spinning. Without polls sends wake the task.
+        ulTaskNotifyTake(pdTRUE, polling ? 1 : (sending ? pdMS_TO_TICKS(SIO_IO_IDLE_CHECK_MS) : portMAX_DELAY));
+    }
+}
+
+// started by the worker connecting the first client, the upgrade only resumes polls of a running task
+static esp_err_t io_start(void)
+{
+    if (io_task != NULL)
+    {
+        return ESP_OK;
+    }
+
+    if (io_slots == NULL && (io_slots = (sio_io_slot_t *)calloc(SIO_MAX_PARALLEL_SOCKETS, sizeof(sio_io_slot_t))) == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate the I/O slots");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(&sio_io_task, "sio_io", CONFIG_SIO_IO_TASK_STACK_SIZE, NULL, 6, &io_task) != pdPASS)
+    {
+        io_task = NULL;
+        ESP_LOGE(TAG, "Failed to start the I/O task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t io_add(sio_client_id_t clientId, uint8_t what)
+{
+    esp_err_t err = io_start();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    __atomic_or_fetch(&io_slots[SIO_REGISTRY_SLOT(clientId)].added, what, __ATOMIC_RELEASE);
+    xTaskNotifyGive(io_task);
+    return ESP_OK;
+}
+
+esp_err_t sio_io_add_polling(sio_client_id_t clientId)
+{
+    return io_add(clientId, SIO_IO_ADD_POLLING);
+}
+
+esp_err_t sio_io_add_sender(sio_client_id_t clientId)
+{
+    return io_add(clientId, SIO_IO_ADD_SENDER);
+}
+
+#else
+
+esp_err_t sio_io_add_polling(sio_client_id_t clientId)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t sio_io_add_sender(sio_client_id_t clientId)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
+
+void sio_io_wake(void)
+{
+    if (io_task != NULL)
+    {
+        xTaskNotifyGive(io_task);
+    }
+}
+
+bool sio_io_is_current(void)
+{
+    return io_task != NULL && xTaskGetCurrentTaskHandle() == io_task;
+}
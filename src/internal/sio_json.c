@@ -0,0 +1,547 @@
+#include <internal/sio_json.h>
+
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "[sio_json]";
+
+// room for the longest number text that still makes sense as a double
+#define SIO_JSON_NUMBER_SIZE 40
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_delimiter(char c)
+{
+    return is_space(c) || c == ',' || c == ']' || c == '}' || c == ':';
+}
+
+static bool is_container(const sio_json_token_t *token)
+{
+    return token->type == SIO_JSON_OBJECT || token->type == SIO_JSON_ARRAY;
+}
+
+// innermost container that is still open before token index, -1 at the top
+static int open_container(const sio_json_t *json, int index)
+{
+    for (int i = index; i >= 0; i--)
+    {
+        if (is_container(&json->tokens[i]) && json->tokens[i].end == -1)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// token behind index and all of its children
+static int skip(const sio_json_t *json, int index)
+{
+    int end = json->tokens[index].end;
+    int next = index + 1;
+    while (next < json->count && json->tokens[next].start < end)
+    {
+        next++;
+    }
+    return next;
+}
+
+// an object only takes keys, a key exactly one value
+static bool takes_value(const sio_json_token_t *parent)
+{
+    return parent == NULL || parent->type == SIO_JSON_ARRAY || (parent->type == SIO_JSON_STRING && parent->size == 0);
+}
+
+// a key whose ':' came without a value after it
+static bool missing_value(const sio_json_token_t *parent)
+{
+    return parent != NULL && parent->type == SIO_JSON_STRING && parent->size == 0;
+}
+
+static sio_json_token_t *add_token(sio_json_t *json, size_t max_tokens, sio_json_type_t type, int start, int end)
+{
+    if ((size_t)json->count == max_tokens)
+    {
+        return NULL;
+    }
+    sio_json_token_t *token = &json->tokens[json->count++];
+    *token = (sio_json_token_t){.type = type, .start = start, .end = end, .size = 0};
+    return token;
+}
+
+// end of the string that starts behind the quote at pos (its closing quote), -1 if it does not end
+static int scan_string(const char *data, size_t len, size_t pos)
+{
+    for (pos++; pos < len; pos++)
+    {
+        if (data[pos] == '"')
+        {
+            return pos;
+        }
+        if (data[pos] == '\\')
+        {
+            pos++;
+        }
+        else if ((unsigned char)data[pos] < 0x20)
+        {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+esp_err_t sio_json_parse(sio_json_t *json, const char *data, size_t len, sio_json_token_t *tokens, size_t max_tokens)
+{
+    *json = (sio_json_t){.data = data, .tokens = tokens, .count = 0};
+
+    // container or key the next value belongs to
+    int super = -1;
+    // a key was read, nothing but its ':' may follow
+    bool want_colon = false;
+    // a value of a container is complete, only ',' or the closing bracket may follow
+    bool want_separator = false;
+    // a ',' was read, the next value (or key) has to follow
+    bool want_item = false;
+
+    for (size_t pos = 0; pos < len; pos++)
+    {
+        char c = data[pos];
+        sio_json_token_t *parent = super == -1 ? NULL : &tokens[super];
+
+        if (is_space(c))
+        {
+            continue;
+        }
+
+        if (want_colon && c != ':')
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        if (super == -1 && json->count > 0)
+        {
+            // the first value is complete
+            break;
+        }
+
+        if (want_separator && c != ',' && c != '}' && c != ']')
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+            if (!takes_value(parent))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (add_token(json, max_tokens, c == '{' ? SIO_JSON_OBJECT : SIO_JSON_ARRAY, pos, -1) == NULL)
+            {
+                return ESP_ERR_NO_MEM;
+            }
+            if (parent != NULL)
+            {
+                parent->size++;
+            }
+            super = json->count - 1;
+            want_item = false;
+            break;
+
+        case '}':
+        case ']':
+        {
+            int open = open_container(json, json->count - 1);
+            if (open == -1 || want_item || missing_value(parent) || tokens[open].type != (c == '}' ? SIO_JSON_OBJECT : SIO_JSON_ARRAY))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            tokens[open].end = pos + 1;
+            super = open_container(json, open - 1);
+            want_separator = true;
+            break;
+        }
+
+        case '"':
+        {
+            int end = scan_string(data, len, pos);
+            // straight in an object it is a key
+            bool key = parent != NULL && parent->type == SIO_JSON_OBJECT;
+            if (end == -1 || (!key && !takes_value(parent)))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (add_token(json, max_tokens, SIO_JSON_STRING, pos + 1, end) == NULL)
+            {
+                return ESP_ERR_NO_MEM;
+            }
+            if (parent != NULL)
+            {
+                parent->size++;
+            }
+            want_colon = key;
+            want_separator = !key;
+            want_item = false;
+            pos = end;
+            break;
+        }
+
+        case ':':
+            // the key before becomes the parent of the value
+            if (!want_colon)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            super = json->count - 1;
+            want_colon = false;
+            break;
+
+        case ',':
+            if (parent == NULL || !want_separator || missing_value(parent))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            want_separator = false;
+            want_item = true;
+            if (!is_container(parent))
+            {
+                // the value of a key is done
+                super = open_container(json, super);
+            }
+            break;
+
+        default:
+        {
+            if (c != '-' && (c < '0' || c > '9') && c != 't' && c != 'f' && c != 'n')
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (!takes_value(parent))
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            size_t end = pos;
+            while (end < len && data[end] != '\0' && !is_delimiter(data[end]))
+            {
+                end++;
+            }
+            if (add_token(json, max_tokens, SIO_JSON_PRIMITIVE, pos, end) == NULL)
+            {
+                return ESP_ERR_NO_MEM;
+            }
+            if (parent != NULL)
+            {
+                parent->size++;
+            }
+            want_separator = true;
+            want_item = false;
+            pos = end - 1;
+            break;
+        }
+        }
+    }
+
+    if (json->count == 0 || tokens[0].end == -1)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sio_json_parse_packet(sio_json_t *json, const Packet_t *packet, sio_json_token_t *tokens, size_t max_tokens)
+{
+    if (packet->json_start == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return sio_json_parse(json, packet->json_start, packet->data + packet->len - packet->json_start, tokens, max_tokens);
+}
+
+const sio_json_token_t *sio_json_get(const sio_json_t *json, const sio_json_token_t *object, const char *key)
+{
+    if (object == NULL || object->type != SIO_JSON_OBJECT)
+    {
+        return NULL;
+    }
+
+    size_t key_len = strlen(key);
+    int index = object - json->tokens + 1;
+    for (int i = 0; i < object->size; i++)
+    {
+        const sio_json_token_t *name = &json->tokens[index];
+        if ((size_t)(name->end - name->start) == key_len && memcmp(json->data + name->start, key, key_len) == 0)
+        {
+            return name->size == 1 ? &json->tokens[index + 1] : NULL;
+        }
+        index = skip(json, index + 1);
+    }
+    return NULL;
+}
+
+const sio_json_token_t *sio_json_at(const sio_json_t *json, const sio_json_token_t *array, int index)
+{
+    if (array == NULL || array->type != SIO_JSON_ARRAY || index < 0 || index >= array->size)
+    {
+        return NULL;
+    }
+
+    int element = array - json->tokens + 1;
+    for (int i = 0; i < index; i++)
+    {
+        element = skip(json, element);
+    }
+    return &json->tokens[element];
+}
+
+const sio_json_token_t *sio_json_find(const sio_json_t *json, const char *path)
+{
+    if (json->count == 0)
+    {
+        return NULL;
+    }
+
+    const sio_json_token_t *token = &json->tokens[0];
+    const char *p = path;
+
+    while (*p != '\0' && token != NULL)
+    {
+        if (*p == '[')
+        {
+            char *end;
+            long index = strtol(p + 1, &end, 10);
+            if (end == p + 1 || *end != ']')
+            {
+                ESP_LOGW(TAG, "Bad index in path %s", path);
+                return NULL;
+            }
+            token = sio_json_at(json, token, index);
+            p = end + 1;
+            continue;
+        }
+
+        if (*p == '.')
+        {
+            p++;
+        }
+
+        size_t key_len = strcspn(p, ".[");
+        if (key_len == 0)
+        {
+            ESP_LOGW(TAG, "Empty key in path %s", path);
+            return NULL;
+        }
+
+        char key[key_len + 1];
+        memcpy(key, p, key_len);
+        key[key_len] = '\0';
+        token = sio_json_get(json, token, key);
+        p += key_len;
+    }
+    return token;
+}
+
+bool sio_json_string(const sio_json_t *json, const sio_json_token_t *token, const char **str, size_t *len)
+{
+    if (token == NULL || token->type != SIO_JSON_STRING)
+    {
+        return false;
+    }
+    *str = json->data + token->start;
+    *len = token->end - token->start;
+    return true;
+}
+
+bool sio_json_equals(const sio_json_t *json, const sio_json_token_t *token, const char *str)
+{
+    const char *value;
+    size_t len;
+    return sio_json_string(json, token, &value, &len) && strlen(str) == len && memcmp(value, str, len) == 0;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void put_char(char *out, size_t out_len, size_t *written, char c)
+{
+    if (*written + 1 < out_len)
+    {
+        out[*written] = c;
+    }
+    (*written)++;
+}
+
+int sio_json_copy_string(const sio_json_t *json, const sio_json_token_t *token, char *out, size_t out_len)
+{
+    if (token == NULL || token->type != SIO_JSON_STRING)
+    {
+        return -1;
+    }
+
+    const char *p = json->data + token->start;
+    const char *end = json->data + token->end;
+    size_t written = 0;
+
+    while (p < end)
+    {
+        char c = *p++;
+        if (c != '\\' || p == end)
+        {
+            put_char(out, out_len, &written, c);
+            continue;
+        }
+
+        char escaped = *p++;
+        switch (escaped)
+        {
+        case 'n':
+            put_char(out, out_len, &written, '\n');
+            break;
+        case 'r':
+            put_char(out, out_len, &written, '\r');
+            break;
+        case 't':
+            put_char(out, out_len, &written, '\t');
+            break;
+        case 'b':
+            put_char(out, out_len, &written, '\b');
+            break;
+        case 'f':
+            put_char(out, out_len, &written, '\f');
+            break;
+        case 'u':
+        {
+            uint32_t code = 0;
+            for (int i = 0; i < 4 && p < end; i++, p++)
+            {
+                int digit = hex_value(*p);
+                code = (code << 4) | (digit < 0 ? 0 : digit);
+            }
+
+            // surrogate pair
+            if (code >= 0xd800 && code <= 0xdbff && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+            {
+                uint32_t low = 0;
+                for (int i = 2; i < 6; i++)
+                {
+                    int digit = hex_value(p[i]);
+                    low = (low << 4) | (digit < 0 ? 0 : digit);
+                }
+                if (low >= 0xdc00 && low <= 0xdfff)
+                {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    p += 6;
+                }
+            }
+
+            if (code < 0x80)
+            {
+                put_char(out, out_len, &written, code);
+            }
+            else if (code < 0x800)
+            {
+                put_char(out, out_len, &written, 0xc0 | (code >> 6));
+                put_char(out, out_len, &written, 0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                put_char(out, out_len, &written, 0xe0 | (code >> 12));
+                put_char(out, out_len, &written, 0x80 | ((code >> 6) & 0x3f));
+                put_char(out, out_len, &written, 0x80 | (code & 0x3f));
+            }
+            else
+            {
+                put_char(out, out_len, &written, 0xf0 | (code >> 18));
+                put_char(out, out_len, &written, 0x80 | ((code >> 12) & 0x3f));
+                put_char(out, out_len, &written, 0x80 | ((code >> 6) & 0x3f));
+                put_char(out, out_len, &written, 0x80 | (code & 0x3f));
+            }
+            break;
+        }
+        default:
+            // '"', '\\' and '/'
+            put_char(out, out_len, &written, escaped);
+            break;
+        }
+    }
+
+    if (out_len > 0)
+    {
+        out[written < out_len ? written : out_len - 1] = '\0';
+    }
+    return written;
+}
+
+esp_err_t sio_json_number(const sio_json_t *json, const sio_json_token_t *token, double *value)
+{
+    if (token == NULL || token->type != SIO_JSON_PRIMITIVE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // copied, the text is not terminated behind the number
+    size_t len = token->end - token->start;
+    char number[SIO_JSON_NUMBER_SIZE];
+    if (len >= sizeof(number))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(number, json->data + token->start, len);
+    number[len] = '\0';
+
+    char *end;
+    *value = strtod(number, &end);
+    return end == number + len && len > 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t sio_json_int(const sio_json_t *json, const sio_json_token_t *token, int32_t *value)
+{
+    double number;
+    esp_err_t err = sio_json_number(json, token, &number);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    *value = (int32_t)number;
+    return ESP_OK;
+}
+
+esp_err_t sio_json_bool(const sio_json_t *json, const sio_json_token_t *token, bool *value)
+{
+    if (token == NULL || token->type != SIO_JSON_PRIMITIVE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *text = json->data + token->start;
+    size_t len = token->end - token->start;
+    if (len == 4 && memcmp(text, "true", 4) == 0)
+    {
+        *value = true;
+        return ESP_OK;
+    }
+    if (len == 5 && memcmp(text, "false", 5) == 0)
+    {
+        *value = false;
+        return ESP_OK;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,338 @@
+#include <internal/sio_namespace.h>
+#include <internal/task_functions.h>
+#include <sio_client.h>
+#include <utility.h>
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char *TAG = "[sio_namespace]";
+
+// index of the namespace or -1
+static int namespace_find(const sio_namespaces_t *namespaces, const char *name, size_t len)
+{
+    for (size_t i = 0; i < CONFIG_SIO_NAMESPACES; i++)
+    {
+        const sio_namespace_t *ns = &namespaces->joined[i];
+        if (ns->name != NULL && ns->name_len == len && memcmp(ns->name, name, len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t sio_namespace_add(sio_namespaces_t *namespaces, const char *nsp, const char *(*alloc_auth_body_cb)(const struct sio_client_t *client))
+{
+    size_t len = strlen(nsp);
+    int index = namespace_find(namespaces, nsp, len);
+    if (index >= 0)
+    {
+        namespaces->joined[index].alloc_auth_body_cb = alloc_auth_body_cb;
+        return ESP_OK;
+    }
+
+    if (namespaces->count == CONFIG_SIO_NAMESPACES)
+    {
+        ESP_LOGE(TAG, "No slot left for namespace %s, increase CONFIG_SIO_NAMESPACES", nsp);
+        return ESP_ERR_NO_MEM;
+    }
+
+    char *name = strdup(nsp);
+    if (name == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t slot = 0;
+    while (namespaces->joined[slot].name != NULL)
+    {
+        slot++;
+    }
+    namespaces->joined[slot] = (sio_namespace_t){
+        .name = name,
+        .name_len = len,
+        .alloc_auth_body_cb = alloc_auth_body_cb};
+    __atomic_store_n(&namespaces->count, namespaces->count + 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+esp_err_t sio_namespace_remove(sio_namespaces_t *namespaces, const char *nsp)
+{
+    int index = namespace_find(namespaces, nsp, strlen(nsp));
+    if (index < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    free(namespaces->joined[index].name);
+    namespaces->joined[index] = (sio_namespace_t){0};
+    __atomic_store_n(&namespaces->count, namespaces->count - 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+void sio_namespace_clear(sio_namespaces_t *namespaces)
+{
+    for (size_t i = 0; i < CONFIG_SIO_NAMESPACES; i++)
+    {
+        freeIfNotNull((void **)&namespaces->joined[i].name);
+    }
+    memset(namespaces, 0, sizeof(sio_namespaces_t));
+}
+
+void sio_namespace_reset(sio_namespaces_t *namespaces)
+{
+    for (size_t i = 0; i < CONFIG_SIO_NAMESPACES; i++)
+    {
+        namespaces->joined[i].pending = false;
+        namespaces->joined[i].connected = false;
+    }
+}
+
+bool sio_namespace_filter_attachment(sio_receive_state_t *state)
+{
+    if (state->attachments_dropped == 0)
+    {
+        return true;
+    }
+    state->attachments_dropped--;
+    return false;
+}
+
+bool sio_namespace_filter(const char *data, size_t len, void *ctx)
+{
+    sio_receive_state_t *state = (sio_receive_state_t *)ctx;
+    if (data[0] == 'b')
+    {
+        // base64 attachment of the binary packet in front of it
+        return sio_namespace_filter_attachment(state);
+    }
+    // attachments come right behind their packet, whatever did not arrive is not coming anymore
+    state->attachments_dropped = 0;
+
+    const char *nsp;
+    size_t nsp_len = sio_packet_namespace(data, len, &nsp);
+    if (nsp_len == 0)
+    {
+        return true;
+    }
+
+    sio_client_t *client = sio_client_acquire(state->client_id);
+    bool joined = false;
+    if (client != NULL)
+    {
+        if (__atomic_load_n(&client->namespaces.count, __ATOMIC_RELAXED) > 0)
+        {
+            lockClient(client);
+            joined = namespace_find(&client->namespaces, nsp, nsp_len) >= 0;
+            unlockClient(client);
+        }
+        sio_client_release(client);
+    }
+
+    if (!joined)
+    {
+        ESP_LOGD(TAG, "Dropped a packet of %.*s, not joined", (int)nsp_len, nsp);
+        if (data[1] == '0' + SIO_PACKET_BINARY_EVENT || data[1] == '0' + SIO_PACKET_BINARY_ACK)
+        {
+            int count = sio_packet_attachment_count(data, len);
+            state->attachments_dropped = count > 0 ? count : 0;
+        }
+    }
+    return joined;
+}
+
+// client locked, '40/name,<auth>' on its way
+static Packet_t *alloc_connect(sio_client_t *client, sio_namespace_t *ns)
+{
+    const char *auth_data = ns->alloc_auth_body_cb == NULL ? NULL : ns->alloc_auth_body_cb(client);
+    Packet_t *packet = alloc_namespace_message(ns->name, auth_data, NULL);
+    free((void *)auth_data);
+
+    if (packet == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate the connect of %s", ns->name);
+        return NULL;
+    }
+    setSioType(packet, SIO_PACKET_CONNECT);
+    ns->pending = true;
+    return packet;
+}
+
+// client not locked, the packet goes with the queue
+static void send_control(sio_client_id_t client_id, Packet_t *packet)
+{
+    if (packet != NULL && sio_send_packet_async(client_id, packet, NULL, NULL) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to queue namespace packet");
+    }
+}
+
+// every joined namespace without a CONNECT on the current session gets one, built under the lock and sent after it
+static void connect_joined(sio_client_t *client)
+{
+    Packet_t *packets[CONFIG_SIO_NAMESPACES];
+    size_t count = 0;
+
+    lockClient(client);
+    for (size_t i = 0; i < CONFIG_SIO_NAMESPACES; i++)
+    {
+        sio_namespace_t *ns = &client->namespaces.joined[i];
+        if (ns->name != NULL && !ns->pending && !ns->connected && (packets[count] = alloc_connect(client, ns)) != NULL)
+        {
+            count++;
+        }
+    }
+    unlockClient(client);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        send_control(client->client_id, packets[i]);
+    }
+}
+
+void sio_namespace_track(sio_client_id_t client_id, const PacketPointerArray_t packets)
+{
+    sio_client_t *client = sio_client_acquire(client_id);
+    if (client == NULL)
+    {
+        return;
+    }
+    if (__atomic_load_n(&client->namespaces.count, __ATOMIC_RELAXED) == 0)
+    {
+        sio_client_release(client);
+        return;
+    }
+
+    bool main_connected = false;
+    for (size_t i = 0; packets[i] != NULL; i++)
+    {
+        const Packet_t *packet = packets[i];
+        if (packet->eio_type != EIO_PACKET_MESSAGE ||
+            (packet->sio_type != SIO_PACKET_CONNECT && packet->sio_type != SIO_PACKET_DISCONNECT &&
+             packet->sio_type != SIO_PACKET_CONNECT_ERROR))
+        {
+            continue;
+        }
+
+        if (packet->nsp == NULL)
+        {
+            // the session is accepted, the namespaces can follow
+            main_connected |= packet->sio_type == SIO_PACKET_CONNECT;
+            continue;
+        }
+
+        lockClient(client);
+        int index = namespace_find(&client->namespaces, packet->nsp, packet->nsp_len);
+        if (index >= 0)
+        {
+            sio_namespace_t *ns = &client->namespaces.joined[index];
+            ns->pending = false;
+            ns->connected = packet->sio_type == SIO_PACKET_CONNECT;
+        }
+        unlockClient(client);
+
+        if (packet->sio_type == SIO_PACKET_CONNECT_ERROR)
+        {
+            ESP_LOGW(TAG, "Client %d could not join %.*s: %s", client_id, (int)packet->nsp_len, packet->nsp,
+                     packet->json_start == NULL ? "" : packet->json_start);
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Client %d %s %.*s", client_id, packet->sio_type == SIO_PACKET_CONNECT ? "joined" : "left",
+                     (int)packet->nsp_len, packet->nsp);
+        }
+    }
+
+    if (main_connected)
+    {
+        connect_joined(client);
+    }
+    sio_client_release(client);
+}
+
+static bool valid_namespace(const char *nsp)
+{
+    // '/' alone is the main namespace, a ',' would end the name on the wire
+    return nsp != NULL && nsp[0] == '/' && nsp[1] != '\0' && strchr(nsp, ',') == NULL;
+}
+
+esp_err_t sio_client_join_namespace(const sio_client_id_t clientId, const char *nsp, sio_auth_body_fptr_t alloc_auth_body_cb)
+{
+    if (!valid_namespace(nsp))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_get_and_lock(clientId);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Client %d does not exist", clientId);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = sio_namespace_add(&client->namespaces, nsp, alloc_auth_body_cb);
+
+    // not connected yet, the servers answer to the main CONNECT takes it along
+    Packet_t *packet = NULL;
+    if (err == ESP_OK && sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED)
+    {
+        sio_namespace_t *ns = &client->namespaces.joined[namespace_find(&client->namespaces, nsp, strlen(nsp))];
+        if (!ns->pending && !ns->connected)
+        {
+            packet = alloc_connect(client, ns);
+        }
+    }
+    unlockClient(client);
+
+    send_control(clientId, packet);
+    return err;
+}
+
+esp_err_t sio_client_leave_namespace(const sio_client_id_t clientId, const char *nsp)
+{
+    if (!valid_namespace(nsp))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_get_and_lock(clientId);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Client %d does not exist", clientId);
+        return ESP_FAIL;
+    }
+
+    int index = namespace_find(&client->namespaces, nsp, strlen(nsp));
+    Packet_t *packet = NULL;
+    if (index >= 0 && sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED &&
+        (client->namespaces.joined[index].pending || client->namespaces.joined[index].connected) &&
+        (packet = alloc_namespace_message(nsp, NULL, NULL)) != NULL)
+    {
+        setSioType(packet, SIO_PACKET_DISCONNECT);
+    }
+
+    esp_err_t err = sio_namespace_remove(&client->namespaces, nsp);
+    unlockClient(client);
+
+    send_control(clientId, packet);
+    return err;
+}
+
+bool sio_client_namespace_connected(const sio_client_id_t clientId, const char *nsp)
+{
+    if (!valid_namespace(nsp))
+    {
+        return false;
+    }
+
+    sio_client_t *client = sio_client_get_and_lock(clientId);
+    if (client == NULL)
+    {
+        return false;
+    }
+
+    int index = namespace_find(&client->namespaces, nsp, strlen(nsp));
+    bool connected = index >= 0 && client->namespaces.joined[index].connected;
+    unlockClient(client);
+    return connected;
+}
@@ -1,5 +1,8 @@
 
 #include <internal/sio_packet.h>
+#include <internal/http_polling_handlers.h>
+#include <internal/sio_scan.h>
+#include <internal/sio_pool.h>
 #include <utility.h>
 
 #include <esp_log.h>
@@ -9,86 +12,264 @@
 static const char *TAG = "[sio_packet]";
 const char *empty_str = "";
 
-static const char base64_table[65] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+// One allocation per received body: header, the NULL terminated pointer array and the packets themselves.
+// Every packet and the array hold a reference, the receive buffer goes with the last one.
+struct sio_packet_batch_t
+{
+    uint32_t refcount;
+    char *buffer;
+    Packet_t *packets[]; // handed out as PacketPointerArray_t, Packet_t storage follows (capacity + 1) pointers
+};
+
+// most polls carry one or two packets, bigger batches grow by doubling
+#define SIO_PACKET_BATCH_INITIAL_CAPACITY 4
+
+static size_t batch_alloc_size(size_t capacity)
+{
+    return sizeof(sio_packet_batch_t) + (capacity + 1) * sizeof(Packet_t *) + capacity * sizeof(Packet_t);
+}
 
-// https://github.com/espressif/esp-idf/blob/8fc8f3f47997aadba21facabc66004c1d22de181/components/wpa_supplicant/src/utils/base64.c#L84C1-L150C2
-static unsigned char *base64_gen_decode(const char *src, size_t len,
-                                        size_t *out_len)
+static Packet_t *batch_storage(sio_packet_batch_t *batch, size_t capacity)
+{
+    return (Packet_t *)&batch->packets[capacity + 1];
+}
+
+// Packets that are not part of a batch (outgoing messages, pong, close).
+// Control packets are a single type digit, their data lives in the block as well.
+#define SIO_PACKET_INLINE_DATA_SIZE 4
+
+typedef struct
+{
+    Packet_t packet; // first, free_packet gets the block from the packet pointer
+    char inline_data[SIO_PACKET_INLINE_DATA_SIZE];
+} sio_packet_block_t;
 
+// a batch with the initial capacity, bigger ones move to the heap when they grow
+typedef struct
 {
-    const char *table = base64_table;
-    unsigned char dtable[256], *out, *pos, block[4], tmp;
-    size_t i, count, olen;
-    int pad = 0;
-    size_t extra_pad;
+    char bytes[sizeof(sio_packet_batch_t) +
+               (SIO_PACKET_BATCH_INITIAL_CAPACITY + 1) * sizeof(Packet_t *) +
+               SIO_PACKET_BATCH_INITIAL_CAPACITY * sizeof(Packet_t)];
+} sio_packet_batch_block_t;
 
-    memset(dtable, 0x80, 256);
-    for (i = 0; i < sizeof(base64_table) - 1; i++)
-        dtable[(unsigned char)table[i]] = (unsigned char)i;
-    dtable['='] = 0;
+SIO_POOL_DEFINE(packet_pool, sio_packet_block_t, CONFIG_SIO_PACKET_POOL_SIZE);
+SIO_POOL_DEFINE(batch_pool, sio_packet_batch_block_t, CONFIG_SIO_PACKET_BATCH_POOL_SIZE);
 
-    count = 0;
-    for (i = 0; i < len; i++)
+// data of outgoing messages, written in place by the emit builders
+typedef struct
+{
+    char bytes[CONFIG_SIO_EMIT_BUFFER_SIZE];
+} sio_emit_buffer_block_t;
+
+SIO_POOL_DEFINE(emit_pool, sio_emit_buffer_block_t, CONFIG_SIO_EMIT_BUFFER_POOL_SIZE);
+
+void sio_packet_pool_stats(sio_pool_stats_t *packets, sio_pool_stats_t *batches)
+{
+    if (packets != NULL)
     {
-        if (dtable[(unsigned char)src[i]] != 0x80)
-            count++;
+        *packets = sio_pool_get_stats(&packet_pool);
     }
+    if (batches != NULL)
+    {
+        *batches = sio_pool_get_stats(&batch_pool);
+    }
+}
 
-    if (count == 0)
-        return NULL;
-    extra_pad = (4 - count % 4) % 4;
+void sio_emit_pool_stats(sio_pool_stats_t *buffers)
+{
+    *buffers = sio_pool_get_stats(&emit_pool);
+}
 
-    olen = (count + extra_pad) / 4 * 3;
-    pos = out = malloc(olen);
-    if (out == NULL)
+static Packet_t *alloc_standalone_packet(void)
+{
+    sio_packet_block_t *block = (sio_packet_block_t *)sio_pool_alloc(&packet_pool);
+    if (block == NULL)
+    {
         return NULL;
+    }
+    block->packet = (Packet_t){0};
+    return &block->packet;
+}
 
-    count = 0;
-    for (i = 0; i < len + extra_pad; i++)
+// does not free the old batch, the caller moves the packets up afterwards
+static sio_packet_batch_t *grow_batch(sio_packet_batch_t *batch, size_t capacity, size_t new_capacity)
+{
+    if (!sio_pool_owns(&batch_pool, batch))
     {
-        unsigned char val;
+        return (sio_packet_batch_t *)realloc(batch, batch_alloc_size(new_capacity));
+    }
 
-        if (i >= len)
-            val = '=';
-        else
-            val = src[i];
-        tmp = dtable[val];
-        if (tmp == 0x80)
-            continue;
+    sio_packet_batch_t *grown = (sio_packet_batch_t *)malloc(batch_alloc_size(new_capacity));
+    if (grown != NULL)
+    {
+        memcpy(grown, batch, batch_alloc_size(capacity));
+        sio_pool_free(&batch_pool, batch);
+    }
+    return grown;
+}
 
-        if (val == '=')
-            pad++;
-        block[count] = tmp;
-        count++;
-        if (count == 4)
+#define BASE64_INVALID 0x80
+#define BASE64_PAD 0x81
+
+// sextet of every base64 character (RFC 4648 alphabet), everything else is skipped like the esp-idf decoder did
+static const uint8_t base64_decode_table[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x81, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// Decodes len base64 characters at src into dst in one pass. dst may be src or in front of it since
+// 4 characters never decode to more than 3 bytes. Missing padding is fine, a dangling single character is not.
+static bool base64_decode(uint8_t *dst, const uint8_t *src, size_t len, size_t *out_len)
+{
+    uint8_t *out = dst;
+    const uint8_t *const end = src + len;
+    uint32_t block = 0;
+    int count = 0;
+
+    while (src < end)
+    {
+        // whole groups of valid characters, the usual case
+        if (count == 0 && end - src >= 4)
         {
-            *pos++ = (block[0] << 2) | (block[1] >> 4);
-            *pos++ = (block[1] << 4) | (block[2] >> 2);
-            *pos++ = (block[2] << 6) | block[3];
-            count = 0;
-            if (pad)
+            uint8_t a = base64_decode_table[src[0]];
+            uint8_t b = base64_decode_table[src[1]];
+            uint8_t c = base64_decode_table[src[2]];
+            uint8_t d = base64_decode_table[src[3]];
+
+            if (((a | b | c | d) & BASE64_INVALID) == 0)
             {
-                if (pad == 1)
-                    pos--;
-                else if (pad == 2)
-                    pos -= 2;
-                else
-                {
-                    /* Invalid padding */
-                    free(out);
-                    return NULL;
-                }
-                break;
+                block = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+                out[0] = block >> 16;
+                out[1] = block >> 8;
+                out[2] = block;
+                out += 3;
+                src += 4;
+                continue;
             }
         }
+
+        // padding, characters to skip or the tail
+        uint8_t sextet = base64_decode_table[*src++];
+        if (sextet == BASE64_PAD)
+        {
+            break;
+        }
+        if (sextet == BASE64_INVALID)
+        {
+            continue;
+        }
+
+        block = (block << 6) | sextet;
+        if (++count == 4)
+        {
+            out[0] = block >> 16;
+            out[1] = block >> 8;
+            out[2] = block;
+            out += 3;
+            block = 0;
+            count = 0;
+        }
     }
 
-    *out_len = pos - out;
-    return out;
+    switch (count)
+    {
+    case 1:
+        return false;
+    case 2:
+        *out++ = block >> 4;
+        break;
+    case 3:
+        *out++ = block >> 10;
+        *out++ = block >> 2;
+        break;
+    default:
+        break;
+    }
+
+    *out_len = out - dst;
+    return true;
 }
 
-void parse_packet(Packet_t *packet)
+// "51-[...]": the attachment count sits between the type and the '-'
+int sio_packet_attachment_count(const char *data, size_t len)
+{
+    unsigned count = 0;
+    size_t i = 2;
+
+    for (; i < len && data[i] >= '0' && data[i] <= '9'; i++)
+    {
+        count = count * 10 + (data[i] - '0');
+        if (count > UINT8_MAX)
+        {
+            break;
+        }
+    }
+
+    if (i == 2 || i >= len || data[i] != '-' || count > UINT8_MAX)
+    {
+        return -1;
+    }
+    return count;
+}
+
+static void parse_attachment_count(Packet_t *packet)
+{
+    int count = sio_packet_attachment_count(packet->data, packet->len);
+    if (count < 0)
+    {
+        ESP_LOGE(TAG, "Invalid attachment count in binary packet");
+        count = 0;
+    }
+    packet->attachment_count = count;
+}
+
+// "42/nsp,17[...]": the ack id is the run of digits right in front of the json, behind the type, the
+// attachment count ('-') or the namespace (',')
+static void parse_ack_id(Packet_t *packet)
+{
+    if (packet->json_start == NULL)
+    {
+        return;
+    }
+
+    const char *first = packet->json_start;
+    while (first > packet->data + 2 && first[-1] >= '0' && first[-1] <= '9')
+    {
+        first--;
+    }
+
+    int32_t id = 0;
+    for (const char *digit = first; digit < packet->json_start; digit++)
+    {
+        if (id > (INT32_MAX - 9) / 10)
+        {
+            ESP_LOGW(TAG, "Ack id out of range");
+            return;
+        }
+        id = id * 10 + (*digit - '0');
+    }
+    if (first < packet->json_start)
+    {
+        packet->ack_id = id;
+    }
+}
+
+// json_scanned: json_candidate already holds the first '{' or '[' of the packet (or NULL), see sio_scan_packet
+static void parse_packet_scanned(Packet_t *packet, bool json_scanned, char *json_candidate)
 {
 
     if (packet->data == NULL)
@@ -97,6 +278,10 @@ void parse_packet(Packet_t *packet)
         return;
     }
 
+    packet->ack_id = -1;
+    packet->nsp = NULL;
+    packet->nsp_len = 0;
+
     if (packet->len < 1)
     {
         ESP_LOGE(TAG, "Packet length is less than 1");
@@ -114,19 +299,23 @@ void parse_packet(Packet_t *packet)
     if (packet->data[0] == 'b')
     {
         packet->eio_type = EIO_PACKET_MESSAGE;
-        packet->sio_type = SIO_PACKET_BINARY_EVENT;
+        packet->sio_type = SIO_PACKET_BINARY_ATTACHMENT;
 
         // Careful with this! binary data starts offset by 1 and is base64 encdoded
+        // decoded in place, the result starts at data and is always shorter (works for batch views and owned data)
 
-        char *decoded_b64 = (char *)base64_gen_decode(packet->data + 1, packet->len - 1, &packet->len);
-
-        if (decoded_b64 == NULL)
+        size_t decoded_len = 0;
+        if (!base64_decode((uint8_t *)packet->data, (const uint8_t *)packet->data + 1, packet->len - 1, &decoded_len))
         {
             ESP_LOGE(TAG, "Failed to decode base64 dataset from SIO");
+            // the prefix is already overwritten, do not hand out half decoded data
+            packet->data[0] = '\0';
+            packet->len = 0;
+            packet->json_start = NULL;
             return;
         }
-        free(packet->data);
-        packet->data = decoded_b64;
+
+        packet->len = decoded_len;
         packet->json_start = NULL;
 
         return;
@@ -148,18 +337,44 @@ void parse_packet(Packet_t *packet)
         packet->json_start = packet->data + 1;
         break;
 
+    case EIO_PACKET_PING:
+    case EIO_PACKET_PONG:
+        // "2probe" / "3probe" of a transport upgrade, nothing to parse
+        break;
+
     case EIO_PACKET_MESSAGE:
         packet->sio_type = (sio_packet_t)(packet->data[1] - '0');
-        // find the start of the json message, (the namespace might be in between but we just ignore it)
 
-        for (int i = 2; i < packet->len; i++)
+        if (packet->sio_type == SIO_PACKET_BINARY_EVENT || packet->sio_type == SIO_PACKET_BINARY_ACK)
         {
-            if (packet->data[i] == '{' || packet->data[i] == '[')
+            parse_attachment_count(packet);
+            packet->nsp_len = sio_packet_namespace(packet->data, packet->len, &packet->nsp);
+        }
+        else if (packet->data[2] == '/')
+        {
+            packet->nsp_len = sio_packet_namespace(packet->data, packet->len, &packet->nsp);
+        }
+
+        // find the start of the json message, behind the namespace if there is one
+
+        if (json_scanned)
+        {
+            // the first two bytes are type digits, the scanner can not have stopped there
+            packet->json_start = json_candidate;
+        }
+        else
+        {
+            for (int i = 2; i < packet->len; i++)
             {
-                packet->json_start = packet->data + i;
-                break;
+                if (packet->data[i] == '{' || packet->data[i] == '[')
+                {
+                    packet->json_start = packet->data + i;
+                    break;
+                }
             }
         }
+
+        parse_ack_id(packet);
         break;
 
     default:
@@ -169,17 +384,192 @@ void parse_packet(Packet_t *packet)
     }
 }
 
+void parse_packet(Packet_t *packet)
+{
+    parse_packet_scanned(packet, false, NULL);
+}
+
+size_t sio_packet_namespace(const char *data, size_t len, const char **nsp)
+{
+    *nsp = NULL;
+    if (len < 3 || data[0] != '0' + EIO_PACKET_MESSAGE)
+    {
+        return 0;
+    }
+
+    size_t i = 2;
+    if (data[1] == '0' + SIO_PACKET_BINARY_EVENT || data[1] == '0' + SIO_PACKET_BINARY_ACK)
+    {
+        // the attachment count comes first
+        while (i < len && data[i] >= '0' && data[i] <= '9')
+        {
+            i++;
+        }
+        if (i < len && data[i] == '-')
+        {
+            i++;
+        }
+    }
+    if (i >= len || data[i] != '/')
+    {
+        return 0;
+    }
+
+    size_t end = i + 1;
+    while (end < len && data[end] != ',')
+    {
+        end++;
+    }
+    if (end - i == 1)
+    {
+        // '/' alone is the main namespace written out
+        return 0;
+    }
+    *nsp = data + i;
+    return end - i;
+}
+
+static void release_batch(sio_packet_batch_t *batch)
+{
+    if (__atomic_sub_fetch(&batch->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        free(batch->buffer);
+        sio_pool_free(&batch_pool, batch);
+    }
+}
+
+PacketPointerArray_t alloc_packet_arr(char *buffer, size_t len, sio_packet_filter_t filter, void *filter_ctx)
+{
+    char *const end = buffer + len;
+    *end = '\0';
+
+    size_t capacity = SIO_PACKET_BATCH_INITIAL_CAPACITY;
+    sio_packet_batch_t *batch = (sio_packet_batch_t *)sio_pool_alloc(&batch_pool);
+    if (batch == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate packet batch");
+        free(buffer);
+        return NULL;
+    }
+
+    // single pass: split in place (the delimiters become the string terminators) and note where the json starts,
+    // empty packets in between are skipped
+    size_t packet_count = 0;
+    for (char *start = buffer; start < end;)
+    {
+        char *json_start = NULL;
+        char *rs = sio_scan_packet(start, end, &json_start);
+        *rs = '\0';
+
+        if (rs > start && (filter == NULL || filter(start, rs - start, filter_ctx)))
+        {
+            if (packet_count == capacity)
+            {
+                sio_packet_batch_t *grown = grow_batch(batch, capacity, capacity * 2);
+                if (grown == NULL)
+                {
+                    ESP_LOGE(TAG, "Failed to grow packet batch to %d packets", (int)(capacity * 2));
+                    sio_pool_free(&batch_pool, batch);
+                    free(buffer);
+                    return NULL;
+                }
+                batch = grown;
+                // the pointer array grew, the packets move up behind it
+                memmove(batch_storage(batch, capacity * 2), batch_storage(batch, capacity), packet_count * sizeof(Packet_t));
+                capacity *= 2;
+            }
+
+            batch_storage(batch, capacity)[packet_count++] = (Packet_t){
+                .data = start,
+                .len = rs - start,
+                .json_start = json_start,
+                .batch = batch};
+        }
+        start = rs + 1;
+    }
+
+    if (packet_count == 0)
+    {
+        sio_pool_free(&batch_pool, batch);
+        free(buffer);
+        return NULL;
+    }
+
+    batch->refcount = packet_count + 1;
+    batch->buffer = buffer;
+
+    Packet_t *storage = batch_storage(batch, capacity);
+    for (size_t i = 0; i < packet_count; i++)
+    {
+        Packet_t *packet = &storage[i];
+        packet->batch = batch; // the block might have moved while growing
+        parse_packet_scanned(packet, true, packet->json_start);
+        batch->packets[i] = packet;
+    }
+    batch->packets[packet_count] = NULL;
+
+    return batch->packets;
+}
+
+PacketPointerArray_t alloc_binary_packet_arr(char *buffer, size_t len)
+{
+    buffer[len] = '\0';
+
+    sio_packet_batch_t *batch = (sio_packet_batch_t *)sio_pool_alloc(&batch_pool);
+    if (batch == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate packet batch");
+        free(buffer);
+        return NULL;
+    }
+
+    Packet_t *packet = batch_storage(batch, SIO_PACKET_BATCH_INITIAL_CAPACITY);
+    *packet = (Packet_t){
+        .eio_type = EIO_PACKET_MESSAGE,
+        .sio_type = SIO_PACKET_BINARY_ATTACHMENT,
+        .data = buffer,
+        .len = len,
+        .batch = batch};
+
+    batch->refcount = 2;
+    batch->buffer = buffer;
+    batch->packets[0] = packet;
+    batch->packets[1] = NULL;
+
+    return batch->packets;
+}
+
 void free_packet(Packet_t **packet_p_p)
 {
     Packet_t *packet_p = *packet_p_p;
 
-    if (packet_p->data != NULL)
+    if (packet_p->attachments != NULL)
     {
-        free(packet_p->data);
-        packet_p->data = NULL;
+        for (uint8_t i = 0; i < packet_p->attachments_received; i++)
+        {
+            free_packet(&packet_p->attachments[i]);
+        }
+        free(packet_p->attachments);
+        packet_p->attachments = NULL;
     }
 
-    free(packet_p);
+    if (packet_p->batch != NULL)
+    {
+        release_batch(packet_p->batch);
+        *packet_p_p = NULL;
+        return;
+    }
+
+    sio_packet_block_t *block = (sio_packet_block_t *)packet_p;
+
+    if (packet_p->data != NULL && packet_p->data != block->inline_data)
+    {
+        // emit pool buffer or heap
+        sio_pool_free(&emit_pool, packet_p->data);
+    }
+    packet_p->data = NULL;
+
+    sio_pool_free(&packet_pool, block);
     *packet_p_p = NULL;
 }
 
@@ -198,6 +588,18 @@ int get_array_size(PacketPointerArray_t arr_p)
     return i;
 }
 
+const char *get_attachment(const Packet_t *packet, uint8_t num, size_t *len)
+{
+    if (packet->attachments == NULL || num >= packet->attachments_received)
+    {
+        return NULL;
+    }
+
+    const Packet_t *attachment = packet->attachments[num];
+    *len = attachment->len;
+    return attachment->data;
+}
+
 void free_packet_arr(PacketPointerArray_t *arr_p)
 {
     PacketPointerArray_t arr = *arr_p;
@@ -211,45 +613,282 @@ void free_packet_arr(PacketPointerArray_t *arr_p)
         free_packet(&p);
         i++;
     }
-    free(arr);
+
+    release_batch((sio_packet_batch_t *)((char *)arr - offsetof(sio_packet_batch_t, packets)));
     *arr_p = NULL;
 }
 
-Packet_t *alloc_message(const char *json_str, const char *event_str)
+size_t sio_json_escape(char *out, const char *in)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t len = 0;
+
+    for (const unsigned char *c = (const unsigned char *)in; *c != '\0'; c++)
+    {
+        char escaped = 0;
+        switch (*c)
+        {
+        case '"':
+            escaped = '"';
+            break;
+        case '\\':
+            escaped = '\\';
+            break;
+        case '\n':
+            escaped = 'n';
+            break;
+        case '\r':
+            escaped = 'r';
+            break;
+        case '\t':
+            escaped = 't';
+            break;
+        case '\b':
+            escaped = 'b';
+            break;
+        case '\f':
+            escaped = 'f';
+            break;
+        default:
+            break;
+        }
+
+        if (escaped != 0)
+        {
+            if (out != NULL)
+            {
+                out[len] = '\\';
+                out[len + 1] = escaped;
+            }
+            len += 2;
+        }
+        else if (*c < 0x20)
+        {
+            if (out != NULL)
+            {
+                memcpy(out + len, "\\u00", 4);
+                out[len + 4] = hex[*c >> 4];
+                out[len + 5] = hex[*c & 0xf];
+            }
+            len += 6;
+        }
+        else
+        {
+            if (out != NULL)
+            {
+                out[len] = *c;
+            }
+            len++;
+        }
+    }
+    return len;
+}
+
+// '42["name",' with the name escaped, out == NULL only counts
+static size_t write_event_header(char *out, const char *name)
+{
+    size_t name_len = sio_json_escape(NULL, name);
+    if (out != NULL)
+    {
+        memcpy(out, "42[\"", 4);
+        sio_json_escape(out + 4, name);
+        memcpy(out + 4 + name_len, "\",", 2);
+    }
+    return 4 + name_len + 2;
+}
+
+esp_err_t sio_event_desc_init(sio_event_desc_t *event, const char *name)
+{
+    event->header_len = write_event_header(NULL, name);
+    event->header = (char *)malloc(event->header_len);
+    if (event->header == NULL)
+    {
+        event->header_len = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    write_event_header(event->header, name);
+    return ESP_OK;
+}
+
+void sio_event_desc_free(sio_event_desc_t *event)
 {
-    if (json_str == NULL)
+    freeIfNotNull((void **)&event->header);
+    event->header_len = 0;
+}
+
+static size_t count_digits(uint32_t value)
+{
+    size_t digits = 1;
+    while (value >= 10)
     {
-        json_str = empty_str;
+        value /= 10;
+        digits++;
     }
+    return digits;
+}
 
-    Packet_t *packet = calloc(1, sizeof(Packet_t));
+// Header, the arguments from writer and the closing bracket in one buffer from the emit pool, or an exactly
+// sized heap buffer if they do not fit. event / name NULL is a plain message: '42' + what writer appends.
+// nsp ('/name,') and then ack_id >= 0 go between the type and the array.
+static Packet_t *build_message(const char *nsp, const sio_event_desc_t *event, const char *name, int64_t ack_id, sio_emit_writer_t writer, void *ctx)
+{
+    bool array = event != NULL || name != NULL;
+    size_t nsp_len = nsp == NULL || strcmp(nsp, "/") == 0 ? 0 : strlen(nsp);
+    size_t id_len = ack_id < 0 ? 0 : count_digits(ack_id);
+    size_t prefix_len = (nsp_len > 0 ? nsp_len + 1 : 0) + id_len;
+    size_t header_len = prefix_len + (event != NULL ? event->header_len : name != NULL ? write_event_header(NULL, name) : 2);
+
+    Packet_t *packet = alloc_standalone_packet();
     if (packet == NULL)
     {
         ESP_LOGE(TAG, "Failed to allocate memory for packet");
         return NULL;
     }
 
-    packet->eio_type = EIO_PACKET_MESSAGE;
-    packet->sio_type = SIO_PACKET_EVENT;
+    size_t capacity = sizeof(sio_emit_buffer_block_t);
+    char *buffer = (char *)sio_pool_alloc(&emit_pool);
 
-    if (event_str == NULL)
+    while (buffer != NULL)
     {
+        if (header_len + 2 > capacity)
+        {
+            // an event name longer than a pool buffer
+            sio_pool_free(&emit_pool, buffer);
+            capacity = header_len + 2;
+            buffer = (char *)malloc(capacity);
+            continue;
+        }
+
+        // the header goes behind the room for namespace and id, its '42' then moves to the front
+        if (event != NULL)
+        {
+            memcpy(buffer + prefix_len, event->header, event->header_len);
+        }
+        else if (name != NULL)
+        {
+            write_event_header(buffer + prefix_len, name);
+        }
+        else
+        {
+            memcpy(buffer + prefix_len, "42", 2);
+        }
+        if (prefix_len > 0)
+        {
+            memcpy(buffer, "42", 2);
+        }
+        if (nsp_len > 0)
+        {
+            memcpy(buffer + 2, nsp, nsp_len);
+            buffer[2 + nsp_len] = ',';
+        }
+        if (id_len > 0)
+        {
+            uint32_t id = ack_id;
+            for (size_t i = id_len; i > 0; i--)
+            {
+                buffer[1 + prefix_len - id_len + i] = '0' + id % 10;
+                id /= 10;
+            }
+        }
+
+        // room for the writers terminator, which becomes the closing bracket
+        size_t space = capacity - header_len - 1;
+        int written = writer == NULL ? 0 : writer(buffer + header_len, space, ctx);
 
-        packet->len = 2 + strlen(json_str);
-        packet->data = calloc(1, packet->len + 1);
+        if (written < 0)
+        {
+            ESP_LOGE(TAG, "Emit writer failed with %d", written);
+            sio_pool_free(&emit_pool, buffer);
+            free_packet(&packet);
+            return NULL;
+        }
+
+        if ((size_t)written < space)
+        {
+            packet->len = header_len + written;
+            if (array && written == 0)
+            {
+                packet->len--; // no arguments, the comma after the name goes
+            }
+            if (array)
+            {
+                buffer[packet->len++] = ']';
+            }
+            buffer[packet->len] = '\0';
+            break;
+        }
 
-        sprintf(packet->data, "42%s", json_str);
+        // did not fit, once more with the size the writer asked for
+        sio_pool_free(&emit_pool, buffer);
+        capacity = header_len + written + 2;
+        buffer = (char *)malloc(capacity);
     }
-    else
+
+    if (buffer == NULL)
     {
-        // Events attach something before the json and make it an array
-        // 42["event",json]
+        ESP_LOGE(TAG, "Failed to allocate memory for message");
+        free_packet(&packet);
+        return NULL;
+    }
+
+    packet->eio_type = EIO_PACKET_MESSAGE;
+    packet->sio_type = SIO_PACKET_EVENT;
+    packet->data = buffer;
+    return packet;
+}
 
-        packet->len = 2 + strlen("[\"") + strlen(event_str) + strlen("\",") + strlen(json_str) + strlen("]");
-        packet->data = calloc(1, packet->len + 1);
+Packet_t *alloc_event(const sio_event_desc_t *event, sio_emit_writer_t writer, void *ctx)
+{
+    return build_message(NULL, event, NULL, -1, writer, ctx);
+}
 
-        sprintf(packet->data, "42[\"%s\",%s]", event_str, json_str);
+Packet_t *alloc_event_named(const char *name, sio_emit_writer_t writer, void *ctx)
+{
+    return build_message(NULL, NULL, name, -1, writer, ctx);
+}
+
+static int write_json_string(char *buffer, size_t len, void *ctx)
+{
+    size_t json_len = strlen((const char *)ctx);
+    if (json_len < len)
+    {
+        memcpy(buffer, ctx, json_len);
     }
+    return json_len;
+}
+
+Packet_t *alloc_message(const char *json_str, const char *event_str)
+{
+    return build_message(NULL, NULL, event_str, -1, write_json_string, (void *)(json_str == NULL ? empty_str : json_str));
+}
+
+Packet_t *alloc_namespace_message(const char *nsp, const char *json_str, const char *event_str)
+{
+    return build_message(nsp, NULL, event_str, -1, write_json_string, (void *)(json_str == NULL ? empty_str : json_str));
+}
+
+Packet_t *alloc_ack_message(const char *json_str, const char *event_str, uint32_t ack_id)
+{
+    return build_message(NULL, NULL, event_str, ack_id, write_json_string, (void *)(json_str == NULL ? empty_str : json_str));
+}
+
+Packet_t *alloc_control_packet(eio_packet_t type)
+{
+    Packet_t *packet = alloc_standalone_packet();
+    if (packet == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate memory for packet");
+        return NULL;
+    }
+
+    sio_packet_block_t *block = (sio_packet_block_t *)packet;
+    block->inline_data[0] = type + '0';
+    block->inline_data[1] = '\0';
+
+    packet->eio_type = type;
+    packet->sio_type = SIO_PACKET_NONE;
+    packet->data = block->inline_data;
+    packet->len = 1;
     return packet;
 }
 
@@ -273,7 +912,7 @@ void setSioType(Packet_t *packet, sio_packet_t type)
 void print_packet(const Packet_t *packet)
 {
     ESP_LOGI(TAG, "Packet: %p EIO:%d SIO:%d len:%d  -- %s",
-             packet, packet->eio_type, packet->sio_type, packet->len,
+             packet, packet->eio_type, packet->sio_type, (int)packet->len,
              packet->data);
 }
 
@@ -0,0 +1,77 @@
+#include <internal/sio_pool.h>
+
+#include <esp_log.h>
+#include <stdlib.h>
+
+static const char *TAG = "[sio_pool]";
+
+bool sio_pool_owns(const sio_pool_t *pool, const void *block)
+{
+    const char *p = (const char *)block;
+    return p >= pool->storage && p < pool->storage + pool->block_size * pool->block_count;
+}
+
+void *sio_pool_alloc(sio_pool_t *pool)
+{
+    void *block = NULL;
+
+    portENTER_CRITICAL(&pool->lock);
+    if (pool->free_list != NULL)
+    {
+        block = pool->free_list;
+        pool->free_list = *(void **)block;
+    }
+    else if (pool->untouched < pool->block_count)
+    {
+        block = pool->storage + pool->block_size * pool->untouched++;
+    }
+
+    if (block != NULL)
+    {
+        pool->stats.in_use++;
+        if (pool->stats.in_use > pool->stats.high_water)
+        {
+            pool->stats.high_water = pool->stats.in_use;
+        }
+    }
+    else
+    {
+        pool->stats.heap_fallbacks++;
+    }
+    portEXIT_CRITICAL(&pool->lock);
+
+    if (block == NULL)
+    {
+        ESP_LOGD(TAG, "Pool %p exhausted (%d blocks), using the heap", pool, pool->block_count);
+        block = malloc(pool->block_size);
+    }
+    return block;
+}
+
+void sio_pool_free(sio_pool_t *pool, void *block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+
+    if (!sio_pool_owns(pool, block))
+    {
+        free(block);
+        return;
+    }
+
+    portENTER_CRITICAL(&pool->lock);
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    pool->stats.in_use--;
+    portEXIT_CRITICAL(&pool->lock);
+}
+
+sio_pool_stats_t sio_pool_get_stats(sio_pool_t *pool)
+{
+    portENTER_CRITICAL(&pool->lock);
+    sio_pool_stats_t stats = pool->stats;
+    portEXIT_CRITICAL(&pool->lock);
+    return stats;
+}
@@ -0,0 +1,287 @@
+#include <internal/sio_reconnect.h>
+#include <internal/sio_json.h>
+#include <sio_client.h>
+#include <utility.h>
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <string.h>
+
+static const char *TAG = "[sio_reconnect]";
+
+// the servers CONNECT data is '{"sid":"..","pid":".."}'
+#define SIO_RECOVERY_JSON_TOKENS 8
+
+uint32_t sio_reconnect_delay_ms(uint16_t attempts)
+{
+#if CONFIG_SIO_RECONNECT
+    uint32_t window = CONFIG_SIO_RECONNECT_DELAY_MAX_MS;
+    if (attempts < 16 && ((uint32_t)CONFIG_SIO_RECONNECT_DELAY_MS << attempts) < window)
+    {
+        window = (uint32_t)CONFIG_SIO_RECONNECT_DELAY_MS << attempts;
+    }
+    // spread over the whole window, devices that lost the same server do not come back in step
+    return esp_random() % (window + 1);
+#else
+    return 0;
+#endif
+}
+
+bool sio_reconnect_schedule(sio_client_t *client)
+{
+#if CONFIG_SIO_RECONNECT
+    sio_reconnect_t *reconnect = &client->reconnect;
+
+    if (CONFIG_SIO_RECONNECT_ATTEMPTS > 0 && reconnect->attempts >= CONFIG_SIO_RECONNECT_ATTEMPTS)
+    {
+        ESP_LOGW(TAG, "Client %d gave up after %d attempts", client->client_id, reconnect->attempts);
+        return false;
+    }
+
+    uint32_t delay_ms = sio_reconnect_delay_ms(reconnect->attempts);
+    reconnect->attempts++;
+    reconnect->not_before = xTaskGetTickCount() + pdMS_TO_TICKS(delay_ms);
+    sio_client_set_status(client, SIO_CLIENT_STARTING);
+    sio_worker_notify(client->client_id);
+
+    ESP_LOGI(TAG, "Client %d reconnects in %lu ms (attempt %d)", client->client_id, (unsigned long)delay_ms, reconnect->attempts);
+    return true;
+#else
+    return false;
+#endif
+}
+
+TickType_t sio_reconnect_due_in(const sio_reconnect_t *reconnect)
+{
+    TickType_t left = reconnect->not_before - xTaskGetTickCount();
+    // wrapped around means it is in the past
+    return (int32_t)left > 0 ? left : 0;
+}
+
+void sio_reconnect_reset(sio_reconnect_t *reconnect)
+{
+    reconnect->attempts = 0;
+    reconnect->not_before = xTaskGetTickCount();
+}
+
+void sio_reconnect_clear(sio_reconnect_t *reconnect)
+{
+    freeIfNotNull((void **)&reconnect->pid);
+    reconnect->offset[0] = '\0';
+    reconnect->recovered = false;
+}
+
+static bool is_json_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// the last argument of '["name",..,"offset"]' if it is a string, found from the end without parsing the rest
+static bool event_offset(const Packet_t *packet, const char **offset, size_t *len)
+{
+    if (packet->eio_type != EIO_PACKET_MESSAGE ||
+        (packet->sio_type != SIO_PACKET_EVENT && packet->sio_type != SIO_PACKET_BINARY_EVENT) ||
+        packet->json_start == NULL)
+    {
+        return false;
+    }
+
+    const char *begin = packet->json_start;
+    const char *p = packet->data + packet->len;
+
+    while (p > begin && is_json_space(p[-1]))
+    {
+        p--;
+    }
+    if (p <= begin || *--p != ']')
+    {
+        return false;
+    }
+    while (p > begin && is_json_space(p[-1]))
+    {
+        p--;
+    }
+    if (p <= begin || *--p != '"')
+    {
+        return false;
+    }
+
+    // inside a string every quote is escaped, the first unescaped one going back opens it
+    const char *end = p;
+    while (true)
+    {
+        if (--p <= begin)
+        {
+            return false;
+        }
+        if (*p != '"')
+        {
+            continue;
+        }
+        size_t backslashes = 0;
+        while (p - backslashes - 1 > begin && p[-(ptrdiff_t)backslashes - 1] == '\\')
+        {
+            backslashes++;
+        }
+        if (backslashes % 2 == 0)
+        {
+            break;
+        }
+    }
+
+    *offset = p + 1;
+    *len = end - *offset;
+
+    // the event name alone is no argument
+    while (p > begin && is_json_space(p[-1]))
+    {
+        p--;
+    }
+    return p > begin && p[-1] == ',';
+}
+
+// the servers answer to our CONNECT, client not locked
+static void track_connect(sio_client_t *client, const Packet_t *packet)
+{
+    sio_json_token_t tokens[SIO_RECOVERY_JSON_TOKENS];
+    sio_json_t json;
+    const char *pid = NULL;
+    size_t pid_len = 0;
+
+    if (sio_json_parse_packet(&json, packet, tokens, SIO_RECOVERY_JSON_TOKENS) == ESP_OK)
+    {
+        sio_json_string(&json, sio_json_get(&json, &tokens[0], "pid"), &pid, &pid_len);
+    }
+
+    lockClient(client);
+    sio_reconnect_t *reconnect = &client->reconnect;
+    bool recovered = pid != NULL && reconnect->pid != NULL &&
+                     strlen(reconnect->pid) == pid_len && memcmp(reconnect->pid, pid, pid_len) == 0;
+    __atomic_store_n(&reconnect->recovered, recovered, __ATOMIC_RELAXED);
+
+    if (!recovered)
+    {
+        // a new session (or none), offsets of the old one mean nothing to the server
+        freeIfNotNull((void **)&reconnect->pid);
+        reconnect->offset[0] = '\0';
+        if (pid != NULL)
+        {
+            reconnect->pid = strndup(pid, pid_len);
+        }
+    }
+    unlockClient(client);
+
+    ESP_LOGI(TAG, "Client %d connected, %s", client->client_id,
+             recovered ? "session recovered" : (pid != NULL ? "new recoverable session" : "no recovery"));
+}
+
+void sio_recovery_track(sio_client_id_t client_id, const PacketPointerArray_t packets)
+{
+    sio_client_t *client = sio_client_acquire(client_id);
+    if (client == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; packets[i] != NULL; i++)
+    {
+        const Packet_t *packet = packets[i];
+
+        // sessions of joined namespaces are not recovered
+        if (packet->nsp != NULL)
+        {
+            continue;
+        }
+
+        if (packet->eio_type == EIO_PACKET_MESSAGE && packet->sio_type == SIO_PACKET_CONNECT)
+        {
+            track_connect(client, packet);
+            continue;
+        }
+
+        // the pid only changes on this task, servers without recovery send no offsets
+        if (client->reconnect.pid == NULL)
+        {
+            continue;
+        }
+
+        const char *offset;
+        size_t len;
+        if (!event_offset(packet, &offset, &len))
+        {
+            continue;
+        }
+        if (len >= SIO_RECOVERY_OFFSET_SIZE)
+        {
+            ESP_LOGW(TAG, "Offset of %d bytes does not fit, the session can not be recovered", (int)len);
+            client->reconnect.offset[0] = '\0';
+            continue;
+        }
+        memcpy(client->reconnect.offset, offset, len);
+        client->reconnect.offset[len] = '\0';
+    }
+    sio_client_release(client);
+}
+
+char *sio_recovery_alloc_auth(const sio_reconnect_t *reconnect, const char *auth)
+{
+    if (reconnect->pid == NULL)
+    {
+        return NULL;
+    }
+
+    // members of the auth object without its braces
+    const char *members = auth;
+    const char *end = auth + strlen(auth);
+    while (members < end && is_json_space(*members))
+    {
+        members++;
+    }
+    while (end > members && is_json_space(end[-1]))
+    {
+        end--;
+    }
+    if (members < end)
+    {
+        if (*members != '{' || end[-1] != '}' || end - members < 2)
+        {
+            ESP_LOGW(TAG, "Auth is no json object, the session can not be recovered");
+            return NULL;
+        }
+        members++;
+        end--;
+        while (members < end && is_json_space(*members))
+        {
+            members++;
+        }
+        while (end > members && is_json_space(end[-1]))
+        {
+            end--;
+        }
+    }
+
+    const char *format = reconnect->offset[0] != '\0' ? "{\"pid\":\"%s\",\"offset\":\"%s\"%s%.*s}" : "{\"pid\":\"%s\"%.0s%s%.*s}";
+    const char *separator = members < end ? "," : "";
+    int len = snprintf(NULL, 0, format, reconnect->pid, reconnect->offset, separator, (int)(end - members), members);
+
+    char *merged = (char *)malloc(len + 1);
+    if (merged == NULL)
+    {
+        return NULL;
+    }
+    snprintf(merged, len + 1, format, reconnect->pid, reconnect->offset, separator, (int)(end - members), members);
+    return merged;
+}
+
+bool sio_client_is_recovered(const sio_client_id_t clientId)
+{
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return false;
+    }
+
+    bool recovered = __atomic_load_n(&client->reconnect.recovered, __ATOMIC_RELAXED);
+    sio_client_release(client);
+    return recovered;
+}
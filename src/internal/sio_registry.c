@@ -0,0 +1,221 @@
+#include <internal/sio_registry.h>
+#include <sio_client.h>
+
+#include <esp_log.h>
+#include <stdlib.h>
+
+static const char *TAG = "[sio_registry]";
+
+#define SIO_REGISTRY_CHUNKS ((SIO_MAX_PARALLEL_SOCKETS + SIO_REGISTRY_CHUNK_SIZE - 1) / SIO_REGISTRY_CHUNK_SIZE)
+#define SIO_REGISTRY_NO_SLOT UINT16_MAX
+
+typedef struct
+{
+    sio_client_t *client;  // NULL while free
+    sio_client_t *retired; // removed, waiting for its last reference. Under the registry lock
+    uint32_t refs;         // the registration and every pin, atomic
+    uint32_t generation;   // of the id handed out last, counted up when the client goes
+    uint16_t next_free;    // free list, under the registry lock
+} sio_registry_slot_t;
+
+typedef struct
+{
+    sio_registry_slot_t slots[SIO_REGISTRY_CHUNK_SIZE];
+} sio_registry_chunk_t;
+
+static sio_registry_chunk_t *chunks[SIO_REGISTRY_CHUNKS];
+static size_t slot_count = 0; // slots in the chunks so far, only grows
+static uint16_t free_head = SIO_REGISTRY_NO_SLOT;
+// taken by add and remove only, short and without allocating
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static sio_registry_slot_t *slot_at(size_t slot)
+{
+    sio_registry_chunk_t *chunk = __atomic_load_n(&chunks[slot / SIO_REGISTRY_CHUNK_SIZE], __ATOMIC_ACQUIRE);
+    return chunk == NULL ? NULL : &chunk->slots[slot % SIO_REGISTRY_CHUNK_SIZE];
+}
+
+// registry locked, the new slots go onto the free list, lowest first
+static void install_chunk(sio_registry_chunk_t *chunk)
+{
+    size_t first = slot_count;
+    size_t end = first + SIO_REGISTRY_CHUNK_SIZE < SIO_MAX_PARALLEL_SOCKETS ? first + SIO_REGISTRY_CHUNK_SIZE : SIO_MAX_PARALLEL_SOCKETS;
+
+    for (size_t i = first; i < end; i++)
+    {
+        chunk->slots[i - first].next_free = i + 1 < end ? (uint16_t)(i + 1) : SIO_REGISTRY_NO_SLOT;
+    }
+
+    __atomic_store_n(&chunks[first / SIO_REGISTRY_CHUNK_SIZE], chunk, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot_count, end, __ATOMIC_RELEASE);
+    free_head = (uint16_t)first;
+}
+
+sio_client_id_t sio_registry_add(sio_client_t *client)
+{
+    // allocated outside the lock, another add may have grown the registry meanwhile
+    sio_registry_chunk_t *spare = NULL;
+
+    while (true)
+    {
+        portENTER_CRITICAL(&registry_lock);
+        if (free_head == SIO_REGISTRY_NO_SLOT && spare != NULL && slot_count < SIO_MAX_PARALLEL_SOCKETS)
+        {
+            install_chunk(spare);
+            spare = NULL;
+        }
+        if (free_head != SIO_REGISTRY_NO_SLOT)
+        {
+            break;
+        }
+        bool full = slot_count >= SIO_MAX_PARALLEL_SOCKETS;
+        portEXIT_CRITICAL(&registry_lock);
+
+        if (full)
+        {
+            free(spare);
+            ESP_LOGE(TAG, "No slot available, destroy a client or increase CONFIG_SIO_MAX_PARALLEL_SOCKETS");
+            return -1;
+        }
+        if (spare == NULL && (spare = (sio_registry_chunk_t *)calloc(1, sizeof(sio_registry_chunk_t))) == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate registry slots");
+            return -1;
+        }
+    }
+
+    size_t index = free_head;
+    sio_registry_slot_t *slot = slot_at(index);
+    free_head = slot->next_free;
+
+    sio_client_id_t id = (sio_client_id_t)((slot->generation << SIO_REGISTRY_SLOT_BITS) | index);
+    client->client_id = id;
+    // added, not set: a lookup that lost the race with the last release may still hold a pin for a moment
+    __atomic_add_fetch(&slot->refs, 1, __ATOMIC_RELAXED);
+    // readers find the client with its id set
+    __atomic_store_n(&slot->client, client, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&registry_lock);
+
+    free(spare);
+    return id;
+}
+
+bool sio_registry_remove(sio_client_id_t id)
+{
+    size_t index = SIO_REGISTRY_SLOT(id);
+    bool removed = false;
+
+    portENTER_CRITICAL(&registry_lock);
+    sio_registry_slot_t *slot = id >= 0 && index < slot_count ? slot_at(index) : NULL;
+    if (slot != NULL && slot->client != NULL && slot->generation == (uint32_t)id >> SIO_REGISTRY_SLOT_BITS)
+    {
+        // the client goes before the generation, a reader that still sees it also sees the old generation
+        slot->retired = slot->client;
+        __atomic_store_n(&slot->client, NULL, __ATOMIC_RELEASE);
+        __atomic_store_n(&slot->generation, (slot->generation + 1) & SIO_REGISTRY_GENERATION_MASK, __ATOMIC_RELEASE);
+        removed = true;
+    }
+    portEXIT_CRITICAL(&registry_lock);
+
+    return removed;
+}
+
+sio_client_t *sio_registry_get(sio_client_id_t id)
+{
+    size_t index = SIO_REGISTRY_SLOT(id);
+    if (id < 0 || index >= __atomic_load_n(&slot_count, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    sio_registry_slot_t *slot = slot_at(index);
+    uint32_t generation = (uint32_t)id >> SIO_REGISTRY_SLOT_BITS;
+    if (__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != generation)
+    {
+        return NULL;
+    }
+
+    sio_client_t *client = __atomic_load_n(&slot->client, __ATOMIC_ACQUIRE);
+
+    // the slot was taken again in between, that client has another id
+    if (__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != generation)
+    {
+        return NULL;
+    }
+    return client;
+}
+
+sio_client_t *sio_registry_acquire(sio_client_id_t id)
+{
+    size_t index = SIO_REGISTRY_SLOT(id);
+    if (id < 0 || index >= __atomic_load_n(&slot_count, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    sio_registry_slot_t *slot = slot_at(index);
+    uint32_t generation = (uint32_t)id >> SIO_REGISTRY_SLOT_BITS;
+    if (__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != generation)
+    {
+        return NULL;
+    }
+
+    __atomic_add_fetch(&slot->refs, 1, __ATOMIC_ACQ_REL);
+
+    // removed before the pin counted, it may be free'd already
+    sio_client_t *client = __atomic_load_n(&slot->client, __ATOMIC_ACQUIRE);
+    if (client == NULL || __atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != generation)
+    {
+        sio_registry_release(id);
+        return NULL;
+    }
+    return client;
+}
+
+void sio_registry_pin(sio_client_id_t id)
+{
+    __atomic_add_fetch(&slot_at(SIO_REGISTRY_SLOT(id))->refs, 1, __ATOMIC_RELAXED);
+}
+
+void sio_registry_release(sio_client_id_t id)
+{
+    size_t index = SIO_REGISTRY_SLOT(id);
+    sio_registry_slot_t *slot = slot_at(index);
+
+    if (__atomic_sub_fetch(&slot->refs, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+
+    // a lookup that lost its race may pin and release the slot meanwhile, only one of us takes the client
+    sio_client_t *retired = NULL;
+    portENTER_CRITICAL(&registry_lock);
+    if (__atomic_load_n(&slot->refs, __ATOMIC_ACQUIRE) == 0 && slot->retired != NULL)
+    {
+        retired = slot->retired;
+        slot->retired = NULL;
+        slot->next_free = free_head;
+        free_head = (uint16_t)index;
+    }
+    portEXIT_CRITICAL(&registry_lock);
+
+    if (retired != NULL)
+    {
+        sio_client_free(retired);
+    }
+}
+
+size_t sio_registry_slots(void)
+{
+    return __atomic_load_n(&slot_count, __ATOMIC_ACQUIRE);
+}
+
+sio_client_id_t sio_registry_id_at(size_t index)
+{
+    sio_registry_slot_t *slot = index < sio_registry_slots() ? slot_at(index) : NULL;
+    if (slot == NULL || __atomic_load_n(&slot->client, __ATOMIC_ACQUIRE) == NULL)
+    {
+        return -1;
+    }
+    return (sio_client_id_t)((__atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) << SIO_REGISTRY_SLOT_BITS) | index);
+}
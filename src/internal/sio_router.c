@@ -0,0 +1,296 @@
+#include <internal/sio_router.h>
+#include <sio_client.h>
+#include <utility.h>
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char *TAG = "[sio_router]";
+
+// FNV-1a, names are short and only hashed once per packet
+static uint32_t route_hash(const char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// slot of the event or -1, probing stops at the first free slot
+static int route_find(const sio_router_t *router, const char *name, size_t len, uint32_t hash)
+{
+    size_t slot = hash % CONFIG_SIO_ROUTER_SIZE;
+    for (size_t probed = 0; probed < CONFIG_SIO_ROUTER_SIZE; probed++)
+    {
+        const sio_route_t *route = &router->routes[slot];
+        if (route->name == NULL)
+        {
+            return -1;
+        }
+        if (route->hash == hash && route->name_len == len && memcmp(route->name, name, len) == 0)
+        {
+            return slot;
+        }
+        slot = (slot + 1) % CONFIG_SIO_ROUTER_SIZE;
+    }
+    return -1;
+}
+
+static bool is_json_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// name and arguments of '["name",args]' without parsing the arguments, false if the packet is no such event
+static bool split_event(const Packet_t *packet, const char **name, size_t *name_len, const char **args, size_t *args_len)
+{
+    if (packet->eio_type != EIO_PACKET_MESSAGE ||
+        (packet->sio_type != SIO_PACKET_EVENT && packet->sio_type != SIO_PACKET_BINARY_EVENT) ||
+        packet->json_start == NULL)
+    {
+        return false;
+    }
+
+    const char *p = packet->json_start;
+    const char *end = packet->data + packet->len;
+
+    if (p >= end || *p++ != '[')
+    {
+        return false;
+    }
+    while (p < end && is_json_space(*p))
+    {
+        p++;
+    }
+    if (p >= end || *p++ != '"')
+    {
+        return false;
+    }
+
+    *name = p;
+    while (p < end && *p != '"')
+    {
+        // skips the escaped character, the name is compared in its escaped form
+        p += *p == '\\' ? 2 : 1;
+    }
+    if (p >= end)
+    {
+        return false;
+    }
+    *name_len = p - *name;
+    p++;
+
+    while (p < end && is_json_space(*p))
+    {
+        p++;
+    }
+
+    *args = p;
+    *args_len = 0;
+    if (p < end && *p == ',')
+    {
+        *args = ++p;
+        const char *last = end;
+        while (last > p && is_json_space(last[-1]))
+        {
+            last--;
+        }
+        if (last > p && last[-1] == ']')
+        {
+            last--;
+        }
+        while (last > p && is_json_space(last[-1]))
+        {
+            last--;
+        }
+        *args_len = last - p;
+    }
+    return true;
+}
+
+esp_err_t sio_router_add(sio_router_t *router, const char *event, sio_on_handler_t handler, void *ctx)
+{
+    size_t len = sio_json_escape(NULL, event);
+    char *name = (char *)malloc(len + 1);
+    if (name == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    sio_json_escape(name, event);
+    name[len] = '\0';
+
+    uint32_t hash = route_hash(name, len);
+    int slot = route_find(router, name, len, hash);
+    if (slot >= 0)
+    {
+        free(name);
+        router->routes[slot].handler = handler;
+        router->routes[slot].ctx = ctx;
+        return ESP_OK;
+    }
+
+    if (router->count == CONFIG_SIO_ROUTER_SIZE)
+    {
+        ESP_LOGE(TAG, "No slot left for event %s, increase CONFIG_SIO_ROUTER_SIZE", event);
+        free(name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t free_slot = hash % CONFIG_SIO_ROUTER_SIZE;
+    while (router->routes[free_slot].name != NULL)
+    {
+        free_slot = (free_slot + 1) % CONFIG_SIO_ROUTER_SIZE;
+    }
+
+    router->routes[free_slot] = (sio_route_t){
+        .hash = hash,
+        .name = name,
+        .name_len = len,
+        .handler = handler,
+        .ctx = ctx};
+    __atomic_store_n(&router->count, router->count + 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+esp_err_t sio_router_remove(sio_router_t *router, const char *event)
+{
+    size_t len = sio_json_escape(NULL, event);
+    char name[len + 1];
+    sio_json_escape(name, event);
+
+    int slot = route_find(router, name, len, route_hash(name, len));
+    if (slot < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    free(router->routes[slot].name);
+    router->routes[slot] = (sio_route_t){0};
+
+    // backward shift instead of tombstones: later entries of the probe chain move up into the hole
+    // unless their home slot lies cyclically between the hole and themselves
+    size_t hole = slot;
+    size_t next = slot;
+    while (true)
+    {
+        next = (next + 1) % CONFIG_SIO_ROUTER_SIZE;
+        if (router->routes[next].name == NULL)
+        {
+            break;
+        }
+
+        size_t home = router->routes[next].hash % CONFIG_SIO_ROUTER_SIZE;
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays)
+        {
+            router->routes[hole] = router->routes[next];
+            router->routes[next] = (sio_route_t){0};
+            hole = next;
+        }
+    }
+
+    __atomic_store_n(&router->count, router->count - 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+void sio_router_clear(sio_router_t *router)
+{
+    for (size_t i = 0; i < CONFIG_SIO_ROUTER_SIZE; i++)
+    {
+        freeIfNotNull((void **)&router->routes[i].name);
+    }
+    memset(router, 0, sizeof(sio_router_t));
+}
+
+void sio_router_dispatch(sio_client_id_t client_id, PacketPointerArray_t packets)
+{
+    sio_client_t *client = sio_client_acquire(client_id);
+    if (client == NULL)
+    {
+        return;
+    }
+    if (__atomic_load_n(&client->router.count, __ATOMIC_RELAXED) == 0)
+    {
+        sio_client_release(client);
+        return;
+    }
+
+    size_t out = 0;
+    for (size_t in = 0; packets[in] != NULL; in++)
+    {
+        Packet_t *packet = packets[in];
+
+        const char *name, *args;
+        size_t name_len, args_len;
+        if (!split_event(packet, &name, &name_len, &args, &args_len))
+        {
+            packets[out++] = packet;
+            continue;
+        }
+        uint32_t hash = route_hash(name, name_len);
+
+        // copied out, the handler runs without the lock
+        sio_on_handler_t handler = NULL;
+        void *ctx = NULL;
+        lockClient(client);
+        int slot = route_find(&client->router, name, name_len, hash);
+        if (slot >= 0)
+        {
+            handler = client->router.routes[slot].handler;
+            ctx = client->router.routes[slot].ctx;
+        }
+        unlockClient(client);
+
+        if (handler == NULL)
+        {
+            packets[out++] = packet;
+            continue;
+        }
+
+        handler(client_id, packet, args, args_len, ctx);
+        free_packet(&packet);
+    }
+
+    packets[out] = NULL;
+    sio_client_release(client);
+}
+
+esp_err_t sio_on(const sio_client_id_t clientId, const char *event, sio_on_handler_t handler, void *ctx)
+{
+    if (event == NULL || handler == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_get_and_lock(clientId);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Client %d does not exist", clientId);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = sio_router_add(&client->router, event, handler, ctx);
+    unlockClient(client);
+    return err;
+}
+
+esp_err_t sio_off(const sio_client_id_t clientId, const char *event)
+{
+    if (event == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_get_and_lock(clientId);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Client %d does not exist", clientId);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = sio_router_remove(&client->router, event);
+    unlockClient(client);
+    return err;
+}
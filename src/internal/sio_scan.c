@@ -0,0 +1,105 @@
+#include <internal/sio_scan.h>
+#include <internal/http_polling_handlers.h>
+
+#include <string.h>
+
+// SWAR ("SIMD within a register"): test every byte of a word at once.
+// For the lowest matching byte the resulting high bit is exact, which is all we need
+// since only the first match is of interest (little endian: lowest byte = lowest address).
+
+typedef uintptr_t __attribute__((__may_alias__)) sio_word_t;
+
+#define SIO_WORD_ONES ((sio_word_t)-1 / 0xFF)
+#define SIO_WORD_HIGHS (SIO_WORD_ONES * 0x80)
+#define SIO_WORD_REPEAT(byte) (SIO_WORD_ONES * (uint8_t)(byte))
+
+// '[' (0x5B) and '{' (0x7B) only differ in 0x20, or-ing that in finds both with one compare
+#define SIO_JSON_START_FOLD 0x20
+#define SIO_JSON_START_FOLDED '{'
+
+static inline sio_word_t word_match(sio_word_t word, sio_word_t pattern)
+{
+    sio_word_t x = word ^ pattern;
+    return (x - SIO_WORD_ONES) & ~x & SIO_WORD_HIGHS;
+}
+
+static inline size_t first_match_index(sio_word_t mask)
+{
+    return (size_t)__builtin_ctzll((unsigned long long)mask) / 8;
+}
+
+static inline bool is_json_start(char c)
+{
+    return c == '{' || c == '[';
+}
+
+char *sio_scan_packet(char *start, char *end, char **json_start)
+{
+    char *p = start;
+    bool json_found = false;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // bytewise until aligned, word loads must not fault on xtensa
+    while (p < end && ((uintptr_t)p & (sizeof(sio_word_t) - 1)) != 0)
+    {
+        if (*p == ASCII_RS)
+        {
+            return p;
+        }
+        if (!json_found && is_json_start(*p))
+        {
+            *json_start = p;
+            json_found = true;
+        }
+        p++;
+    }
+
+    const sio_word_t rs_pattern = SIO_WORD_REPEAT(ASCII_RS);
+    const sio_word_t fold = SIO_WORD_REPEAT(SIO_JSON_START_FOLD);
+    const sio_word_t json_pattern = SIO_WORD_REPEAT(SIO_JSON_START_FOLDED);
+
+    // fused loop until the json start is known, afterwards only delimiters are of interest
+    for (; !json_found && end - p >= (ptrdiff_t)sizeof(sio_word_t); p += sizeof(sio_word_t))
+    {
+        sio_word_t word = *(const sio_word_t *)p;
+        sio_word_t rs_mask = word_match(word, rs_pattern);
+        sio_word_t json_mask = word_match(word | fold, json_pattern);
+
+        if (json_mask != 0)
+        {
+            size_t json_index = first_match_index(json_mask);
+            if (rs_mask == 0 || json_index < first_match_index(rs_mask))
+            {
+                *json_start = p + json_index;
+                json_found = true;
+            }
+        }
+        if (rs_mask != 0)
+        {
+            return p + first_match_index(rs_mask);
+        }
+    }
+
+    if (json_found)
+    {
+        // only the delimiter is left to find, libc memchr is at least word-at-a-time as well (vectorized on the host)
+        char *rs = (char *)memchr(p, ASCII_RS, end - p);
+        return rs == NULL ? end : rs;
+    }
+#endif
+
+    // tail (or everything on big endian)
+    for (; p < end; p++)
+    {
+        if (*p == ASCII_RS)
+        {
+            return p;
+        }
+        if (!json_found && is_json_start(*p))
+        {
+            *json_start = p;
+            json_found = true;
+        }
+    }
+    return end;
+}
@@ -1,18 +1,22 @@
 #include <sio_types.h>
 #include <internal/sio_packet.h>
 #include <internal/sio_send.h>
+#include <internal/sio_stream.h>
 #include <internal/task_functions.h>
+#include <internal/http_polling_handlers.h>
+#include <internal/sio_io.h>
 #include <utility.h>
 #include <cJSON.h>
 
 #include <esp_log.h>
+#include <errno.h>
 static const char *TAG = "[sio_socketio]";
 
 ESP_EVENT_DEFINE_BASE(SIO_EVENT);
 
 esp_err_t sio_send_string(const sio_client_id_t clientId, const char *data)
 {
-    ESP_LOGD(TAG, "Sending string: %s %d", data, strlen(data));
+    ESP_LOGD(TAG, "Sending string: %s %d", data, (int)strlen(data));
 
     Packet_t *p = alloc_message(data, "message");
     // print_packet(p);
@@ -21,49 +25,290 @@ esp_err_t sio_send_string(const sio_client_id_t clientId, const char *data)
     return ret;
 }
 
-esp_err_t sio_send_packet(const sio_client_id_t clientId, const Packet_t *packet)
+static bool is_sendable(const sio_client_t *client)
 {
-    sio_client_t *client = sio_client_get_and_lock(clientId);
+    sio_client_status_t status = sio_client_get_status(client);
+    return status == SIO_CLIENT_STATUS_CONNECTED || status == SIO_CLIENT_CLOSING;
+}
 
-    if (client->status != SIO_CLIENT_STATUS_CONNECTED &&
-        client->status != SIO_CLIENT_CLOSING)
+// an upgrade switches it under the send lock only, see sio_upgrade.c
+static sio_transport_t current_transport(const sio_client_t *client)
+{
+    return __atomic_load_n(&client->transport, __ATOMIC_ACQUIRE);
+}
+
+void sio_sender_wake(sio_client_t *client)
+{
+    xSemaphoreGive(client->outbound_signal);
+#if CONFIG_SIO_IO_TASK
+    sio_io_wake();
+#endif
+}
+
+// Lock-free push onto the clients outbound stack, the sender task takes all of it at once.
+// false once the sender closed the stack (SIO_OUTBOUND_CLOSED), the sender can not stop with the entry on it.
+static bool outbound_push(sio_client_t *client, sio_outbound_t *entry)
+{
+    sio_outbound_t *head = __atomic_load_n(&client->outbound_head, __ATOMIC_RELAXED);
+    do
     {
-        ESP_LOGE(TAG, "Client not in sendable state %d", client->status);
-        unlockClient(client);
+        if (head == SIO_OUTBOUND_CLOSED)
+        {
+            return false;
+        }
+        entry->next = head;
+    } while (!__atomic_compare_exchange_n(&client->outbound_head, &head, entry, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    sio_sender_wake(client);
+    return true;
+}
+
+// everything pushed so far, oldest first
+static sio_outbound_t *outbound_take_all(sio_client_t *client)
+{
+    sio_outbound_t *entry = __atomic_exchange_n(&client->outbound_head, NULL, __ATOMIC_ACQUIRE);
+    sio_outbound_t *reversed = NULL;
 
+    while (entry != NULL)
+    {
+        sio_outbound_t *next = entry->next;
+        entry->next = reversed;
+        reversed = entry;
+        entry = next;
+    }
+    return reversed;
+}
+
+static esp_err_t outbound_enqueue(sio_client_t *client, sio_outbound_t *entry)
+{
+    if (!is_sendable(client))
+    {
+        ESP_LOGE(TAG, "Client not in sendable state %d", sio_client_get_status(client));
         return ESP_FAIL;
     }
-    esp_err_t ret = ESP_FAIL;
 
-    if (client->transport == SIO_TRANSPORT_WEBSOCKETS)
+    if (!outbound_push(client, entry))
     {
-        ret = sio_send_packet_websocket(client, packet);
+        ESP_LOGE(TAG, "Sender of client %d is not running", client->client_id);
+        return ESP_ERR_INVALID_STATE;
     }
-    else if (client->transport == SIO_TRANSPORT_POLLING)
+    return ESP_OK;
+}
+
+esp_err_t sio_send_packet(const sio_client_id_t clientId, const Packet_t *packet)
+{
+    if (sio_io_is_current())
     {
-        ret = sio_send_packet_polling(client, packet);
+        // handlers on the I/O task would wait for the task that has to send it
+        ESP_LOGE(TAG, "Blocking send on the I/O task, use sio_send_packet_async");
+        return ESP_ERR_INVALID_STATE;
     }
-    else
+
+    // queueing needs no client lock, see outbound_push
+    sio_client_t *client = sio_client_acquire(clientId);
+
+    if (client == NULL)
     {
-        ret = ESP_ERR_INVALID_ARG;
+        return ESP_ERR_INVALID_ARG;
     }
 
-    unlockClient(client);
+    // the sender task signals when the POST / frame that carried the packet is done
+    sio_outbound_t entry = {
+        .packet = (Packet_t *)packet,
+        .result = ESP_FAIL};
+    entry.done = xSemaphoreCreateBinaryStatic(&entry.done_buffer);
+
+    esp_err_t ret = outbound_enqueue(client, &entry);
+
+    if (ret == ESP_OK)
+    {
+        xSemaphoreTake(entry.done, portMAX_DELAY);
+        ret = entry.result;
+    }
+
+    sio_client_release(client);
     return ret;
 }
 
-// TODO: figure out why this is necessary,
-// https://github.com/ZweiEuro/socketio-esp-idf/issues/1
-#define REBUILD_CLIENT_POST 0
+esp_err_t sio_send_packet_async(const sio_client_id_t clientId, Packet_t *packet, sio_send_cb_t cb, void *ctx)
+{
+    sio_client_t *client = sio_client_acquire(clientId);
 
-esp_err_t sio_send_packet_polling(sio_client_t *client, const Packet_t *packet)
+    if (client == NULL)
+    {
+        free_packet(&packet);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (__atomic_add_fetch(&client->outbound_async_count, 1, __ATOMIC_RELAXED) > SIO_DEFAULT_MESSAGE_QUEUE_SIZE)
+    {
+        __atomic_sub_fetch(&client->outbound_async_count, 1, __ATOMIC_RELAXED);
+        ESP_LOGD(TAG, "Outbound queue of client %d full", clientId);
+        free_packet(&packet);
+        sio_client_release(client);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    sio_outbound_t *entry = (sio_outbound_t *)calloc(1, sizeof(sio_outbound_t));
+
+    if (entry != NULL)
+    {
+        entry->packet = packet;
+        entry->on_sent = cb;
+        entry->on_sent_ctx = ctx;
+        ret = outbound_enqueue(client, entry);
+    }
+
+    if (ret != ESP_OK)
+    {
+        __atomic_sub_fetch(&client->outbound_async_count, 1, __ATOMIC_RELAXED);
+        free(entry);
+        free_packet(&packet);
+    }
+
+    sio_client_release(client);
+    return ret;
+}
+
+esp_err_t sio_emit_async(const sio_client_id_t clientId, const char *event, const char *json, sio_send_cb_t cb, void *ctx)
+{
+    Packet_t *p = alloc_message(json, event);
+    if (p == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return sio_send_packet_async(clientId, p, cb, ctx);
+}
+
+esp_err_t sio_emit_to_async(const sio_client_id_t clientId, const char *nsp, const char *event, const char *json, sio_send_cb_t cb, void *ctx)
 {
-    static PacketPointerArray_t packets;
-    packets = NULL;
+    Packet_t *p = alloc_namespace_message(nsp, json, event);
+    if (p == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return sio_send_packet_async(clientId, p, cb, ctx);
+}
 
-    { // scope for first url without session id
+int sio_emit_write_cjson(char *buffer, size_t len, void *json)
+{
+    if (cJSON_PrintPreallocated((cJSON *)json, buffer, len, false))
+    {
+        return strlen(buffer);
+    }
+
+    // bigger than the pool buffer: print once to learn the size, cJSON wants 5 bytes of slack
+    char *printed = cJSON_PrintUnformatted((cJSON *)json);
+    if (printed == NULL)
+    {
+        return -1;
+    }
+    int needed = strlen(printed) + 5;
+    cJSON_free(printed);
+    return needed;
+}
+
+esp_err_t sio_emit_writer_async(const sio_client_id_t clientId, const char *event, sio_emit_writer_t writer, void *writer_ctx, sio_send_cb_t cb, void *ctx)
+{
+    Packet_t *p = alloc_event_named(event, writer, writer_ctx);
+    if (p == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return sio_send_packet_async(clientId, p, cb, ctx);
+}
+
+esp_err_t sio_emit_event_async(const sio_client_id_t clientId, const sio_event_desc_t *event, sio_emit_writer_t writer, void *writer_ctx, sio_send_cb_t cb, void *ctx)
+{
+    Packet_t *p = alloc_event(event, writer, writer_ctx);
+    if (p == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return sio_send_packet_async(clientId, p, cb, ctx);
+}
+
+esp_err_t sio_emit_cjson_async(const sio_client_id_t clientId, const char *event, const cJSON *json, sio_send_cb_t cb, void *ctx)
+{
+    return sio_emit_writer_async(clientId, event, sio_emit_write_cjson, (void *)json, cb, ctx);
+}
+
+// A failed POST on a connection that was kept alive is only sent again when it provably never reached the
+// server: connect failed, the request did not get out completely (a server does not act on half a body),
+// or the server side closed or reset the idle connection before a byte of the answer (esp_http_client
+// fails fetching the headers). After a timeout the server may well be working on it, so that one fails.
+static bool post_never_sent(sio_client_t *client, const sio_stream_t *stream, esp_err_t err, TickType_t elapsed)
+{
+    if (err == ESP_OK || stream->response_started)
+    {
+        return false;
+    }
+
+    int error = esp_http_client_get_errno(client->posting_client);
+    if (err == ESP_ERR_HTTP_EAGAIN || error == EAGAIN || error == EWOULDBLOCK || error == ETIMEDOUT ||
+        elapsed >= pdMS_TO_TICKS(SIO_POST_TIMEOUT_MS))
+    {
+        return false;
+    }
+
+    return !stream->request_sent || err == ESP_ERR_HTTP_WRITE_DATA || err == ESP_ERR_HTTP_FETCH_HEADER;
+}
+
+// Everything up to the request of the first count packets of the list as one RS separated body. Called without
+// the client lock, the request runs under the send lock, which stays taken on ESP_OK until post_step is done.
+// With CONFIG_SIO_POST_KEEP_ALIVE posting_client keeps its connection open between POSTs,
+// esp_http_client opens a new one when the server answered with "Connection: close".
+static esp_err_t post_begin(sio_client_t *client, sio_post_t *post, sio_outbound_t *entries, size_t count, size_t body_len)
+{
+    sio_stream_t *stream = &client->posting_stream;
+
+    // a single packet goes out as it is, only batches need a body of their own
+    char *body = NULL;
+    if (count > 1)
+    {
+        body = (char *)malloc(body_len);
+        if (body == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate POST body of %d bytes", (int)body_len);
+            return ESP_ERR_NO_MEM;
+        }
 
-        char *url = alloc_post_url(client);
+        char *pos = body;
+        sio_outbound_t *entry = entries;
+        for (size_t i = 0; i < count; i++, entry = entry->next)
+        {
+            if (i > 0)
+            {
+                *pos++ = ASCII_RS;
+            }
+            memcpy(pos, entry->packet->data, entry->packet->len);
+            pos += entry->packet->len;
+        }
+    }
+
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    if (current_transport(client) != SIO_TRANSPORT_POLLING)
+    {
+        // upgraded to the websocket while the batch was put together, the sender sends it again as frames
+        xSemaphoreGive(client->send_lock);
+        freeIfNotNull((void **)&body);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (client->post_url == NULL)
+    {
+        ESP_LOGE(TAG, "No session to POST to");
+        xSemaphoreGive(client->send_lock);
+        freeIfNotNull((void **)&body);
+        return ESP_FAIL;
+    }
+    sio_stream_reset(stream);
+
+    // same url as the last POST, just a new cache buster
+    sio_write_token(client->post_url_token);
+    const char *url = client->post_url;
+
+    { // scope for first url without session id
 
         if (client->posting_client == NULL)
         {
@@ -73,32 +318,98 @@ esp_err_t sio_send_packet_polling(sio_client_t *client, const Packet_t *packet)
             esp_http_client_config_t config = {
                 .url = url,
                 .event_handler = http_client_polling_post_handler,
-                .user_data = &packets,
+                .user_data = stream,
                 .disable_auto_redirect = true,
                 .method = HTTP_METHOD_POST,
+#if CONFIG_SIO_IO_TASK
+                // a slice of the I/O task per perform, SIO_POST_TIMEOUT_MS is counted by post_step
+                .is_async = true,
+                .timeout_ms = CONFIG_SIO_IO_SLICE_MS,
+#else
+                .timeout_ms = SIO_POST_TIMEOUT_MS,
+#endif
             };
             client->posting_client = esp_http_client_init(&config);
 
             if (client->posting_client == NULL)
             {
                 ESP_LOGE(TAG, "Failed to initialize HTTP client");
+                xSemaphoreGive(client->send_lock);
+                freeIfNotNull((void **)&body);
                 return ESP_FAIL;
             }
         }
         esp_http_client_set_header(client->posting_client, "Content-Type", "text/plain;charset=UTF-8");
         esp_http_client_set_header(client->posting_client, "Accept", "*/*");
         esp_http_client_set_method(client->posting_client, HTTP_METHOD_POST);
-        esp_http_client_set_post_field(client->posting_client, packet->data, packet->len);
+        esp_http_client_set_post_field(client->posting_client,
+                                       body == NULL ? entries->packet->data : body,
+                                       body == NULL ? entries->packet->len : body_len);
 
         esp_http_client_set_url(client->posting_client, url);
-
-        freeIfNotNull(&url);
     }
 
+    stream->request_sent = false;
+    stream->response_started = false;
+    *post = (sio_post_t){
+        .batch = entries,
+        .count = count,
+        .body = body,
+        .connections = stream->connections,
+        .started = xTaskGetTickCount()};
+    return ESP_OK;
+}
+
+// Drives the POST post_begin started. ESP_ERR_HTTP_EAGAIN while an async one is still on its way, anything else
+// is its result and the send lock is given back.
+static esp_err_t post_step(sio_client_t *client, sio_post_t *post)
+{
+    sio_stream_t *stream = &client->posting_stream;
     esp_err_t err = esp_http_client_perform(client->posting_client);
+    TickType_t elapsed = xTaskGetTickCount() - post->started;
+
+    if (err == ESP_ERR_HTTP_EAGAIN)
+    {
+        if (elapsed < pdMS_TO_TICKS(SIO_POST_TIMEOUT_MS))
+        {
+            return ESP_ERR_HTTP_EAGAIN;
+        }
+        // async requests have no timeout of their own
+        err = ESP_ERR_TIMEOUT;
+    }
+
+    if (!post->retried && stream->connections == post->connections && post_never_sent(client, stream, err, elapsed))
+    {
+        // the kept connection was closed by the server or a proxy while idle, the request
+        // did not get through on it. Once more on a new connection
+        ESP_LOGD(TAG, "Kept-alive POST connection gone (%s), reconnecting", esp_err_to_name(err));
+        esp_http_client_close(client->posting_client);
+        sio_stream_reset(stream);
+        stream->request_sent = false;
+        stream->response_started = false;
+        post->retried = true;
+        post->started = xTaskGetTickCount();
+        return post_step(client, post);
+    }
+
+    if (stream->connections == post->connections)
+    {
+        __atomic_add_fetch(&client->post_stats.reused, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&client->post_stats.connected, 1, __ATOMIC_RELAXED);
+    }
+
+    freeIfNotNull((void **)&post->body);
+
+    PacketPointerArray_t packets = stream->packets;
+    stream->packets = NULL;
+
     if (err != ESP_OK || packets == NULL)
     {
         ESP_LOGE(TAG, "HTTP POST request failed: %s response: %p ", esp_err_to_name(err), packets);
+        err = err == ESP_OK ? ESP_FAIL : err;
         goto cleanup;
     }
 
@@ -111,7 +422,7 @@ esp_err_t sio_send_packet_polling(sio_client_t *client, const Packet_t *packet)
     // allocate posting user if not present
     if (packets[0]->eio_type == EIO_PACKET_OK_SERVER)
     {
-        ESP_LOGD(TAG, "Ok from server response array %p", packets);
+        ESP_LOGD(TAG, "Ok from server for %d packets", (int)post->count);
     }
     else
     {
@@ -124,29 +435,293 @@ cleanup:
     {
         free_packet_arr(&packets);
     }
-    if (client->posting_client != NULL)
+#if CONFIG_SIO_POST_KEEP_ALIVE
+    if (err != ESP_OK)
+#endif
     {
-#if REBUILD_CLIENT_POST
-        esp_http_client_cleanup(client->posting_client);
-        client->posting_client = NULL;
-#else
+        // whatever state the connection is in, the next POST starts on a new one
         esp_http_client_close(client->posting_client);
-#endif
     }
+    xSemaphoreGive(client->send_lock);
 
     return err;
 }
 
-esp_err_t sio_send_packet_websocket(sio_client_t *client, const Packet_t *packet)
+// POSTs the first count packets of the list and waits for the result
+static esp_err_t post_packets(sio_client_t *client, sio_outbound_t *entries, size_t count, size_t body_len)
 {
-    assert(false && "Not implemented");
-    return ESP_OK;
+    sio_post_t post;
+    esp_err_t err = post_begin(client, &post, entries, count, body_len);
+
+    while (err == ESP_OK && (err = post_step(client, &post)) == ESP_ERR_HTTP_EAGAIN)
+    {
+        // the async posting_client of the I/O task, a connect in progress returns right away
+        vTaskDelay(1);
+    }
+    return err;
 }
 
-bool sio_client_is_connected(sio_client_id_t clientId)
+// Wakes sync senders and runs the callbacks of async ones, client not locked (callbacks may query it)
+static void complete_entries(sio_client_t *client, sio_outbound_t *entry, size_t count, esp_err_t result)
+{
+    for (size_t i = 0; i < count && entry != NULL; i++)
+    {
+        sio_outbound_t *next = entry->next;
+
+        if (entry->done != NULL)
+        {
+            // the entry is gone as soon as its sender wakes up
+            entry->result = result;
+            xSemaphoreGive(entry->done);
+        }
+        else
+        {
+            if (entry->on_sent != NULL)
+            {
+                entry->on_sent(client->client_id, result, entry->on_sent_ctx);
+            }
+            else if (result != ESP_OK)
+            {
+                sio_event_data_t event_data = {
+                    .client_id = client->client_id,
+                    .packets_pointer = NULL,
+                    .len = 0};
+                esp_event_post(SIO_EVENT, SIO_EVENT_SEND_FAILED, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
+            }
+
+            free_packet(&entry->packet);
+            free(entry);
+            __atomic_sub_fetch(&client->outbound_async_count, 1, __ATOMIC_RELAXED);
+        }
+
+        entry = next;
+    }
+}
+
+static size_t list_length(const sio_outbound_t *entry)
+{
+    size_t count = 0;
+    for (; entry != NULL; entry = entry->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+static sio_outbound_t *list_append(sio_outbound_t *list, sio_outbound_t *tail)
+{
+    if (list == NULL)
+    {
+        return tail;
+    }
+
+    sio_outbound_t *last = list;
+    while (last->next != NULL)
+    {
+        last = last->next;
+    }
+    last->next = tail;
+    return list;
+}
+
+// how often an idle sender looks at the client status
+#define SIO_SENDER_IDLE_CHECK_MS 1000
+
+// Another step of the running POST, false while it is still on its way. Once it is done its packets are completed.
+static bool post_continue(sio_client_t *client, sio_post_t *post)
+{
+    esp_err_t err = post_step(client, post);
+    if (err == ESP_ERR_HTTP_EAGAIN)
+    {
+        return false;
+    }
+
+    complete_entries(client, post->batch, post->count, err);
+    post->batch = NULL;
+    return true;
+}
+
+bool sio_sender_round(sio_client_t *client, sio_sender_t *sender)
+{
+    // a POST of an earlier round goes first, whatever the status is by now (it ends with its timeout)
+    if (sender->post.batch != NULL && !post_continue(client, &sender->post))
+    {
+        return true;
+    }
+
+    sio_outbound_t *pending = list_append(sender->pending, outbound_take_all(client));
+
+    if (sio_client_get_status(client) == SIO_CLIENT_STATUS_HANDSHOOK)
+    {
+        // started by sio_connect just before the client is connected, nothing to do yet
+        sender->pending = pending;
+        return true;
+    }
+
+    if (!is_sendable(client))
+    {
+        pending = list_append(pending, outbound_take_all(client));
+        if (pending == NULL)
+        {
+            // decided under the lock so sio_sender_start sees either this sender or none. The stack only closes
+            // while empty, a producer that got in first fails with the next round.
+            lockClient(client);
+            sio_outbound_t *empty = NULL;
+            bool stop = !is_sendable(client) && sio_client_get_status(client) != SIO_CLIENT_STATUS_HANDSHOOK &&
+                        __atomic_compare_exchange_n(&client->outbound_head, &empty, SIO_OUTBOUND_CLOSED, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+            if (stop)
+            {
+                client->sender_running = false;
+            }
+            unlockClient(client);
+            sender->pending = NULL;
+            return !stop;
+        }
+
+        complete_entries(client, pending, list_length(pending), ESP_ERR_INVALID_STATE);
+        sender->pending = NULL;
+        return true;
+    }
+
+    while (pending != NULL && is_sendable(client))
+    {
+        if (current_transport(client) == SIO_TRANSPORT_WEBSOCKETS)
+        {
+            // a frame per packet, nothing to batch
+            sio_outbound_t *entry = pending;
+            pending = entry->next;
+
+            complete_entries(client, entry, 1, sio_send_packet_websocket(client, entry->packet));
+
+            pending = list_append(pending, outbound_take_all(client));
+            continue;
+        }
+
+        // everything that queued up while the last POST ran goes into this one
+        size_t count = 1;
+        size_t body_len = pending->packet->len;
+        sio_outbound_t *last = pending;
+
+        while (last->next != NULL && body_len + 1 + last->next->packet->len <= client->server_max_payload)
+        {
+            last = last->next;
+            body_len += 1 + last->packet->len;
+            count++;
+        }
+
+        sio_outbound_t *batch = pending;
+        pending = last->next;
+
+        esp_err_t err = post_begin(client, &sender->post, batch, count, body_len);
+        if (err == ESP_ERR_INVALID_STATE)
+        {
+            // the batch is still linked in front of the rest
+            pending = batch;
+            continue;
+        }
+        if (err != ESP_OK)
+        {
+            complete_entries(client, batch, count, err);
+        }
+        else if (!post_continue(client, &sender->post))
+        {
+            // async, the next round goes on with it
+            sender->pending = pending;
+            return true;
+        }
+
+        pending = list_append(pending, outbound_take_all(client));
+    }
+
+    sender->pending = pending;
+    return true;
+}
+
+void sio_sender_task(void *pvParameters)
 {
+    sio_client_id_t clientId = (sio_client_id_t)(intptr_t)pvParameters;
+
     sio_client_t *client = sio_client_get_and_lock(clientId);
-    bool ret = client->status == SIO_CLIENT_STATUS_CONNECTED;
+    assert(client != NULL && "Client is NULL");
+    SemaphoreHandle_t signal = client->outbound_signal;
     unlockClient(client);
-    return ret;
+
+    ESP_LOGI(TAG, "Started sender task for client %d", clientId);
+
+    sio_sender_t sender = {0};
+
+    // the client outlives this task, sio_client_destroy waits for sender_running to drop
+    do
+    {
+        xSemaphoreTake(signal, pdMS_TO_TICKS(SIO_SENDER_IDLE_CHECK_MS));
+    } while (sio_sender_round(client, &sender));
+
+    ESP_LOGI(TAG, "Stopped sender task for client %d", clientId);
+    vTaskDelete(NULL);
+}
+
+esp_err_t sio_sender_start(sio_client_t *client)
+{
+    if (client->sender_running)
+    {
+        return ESP_OK;
+    }
+
+    client->sender_running = true;
+    __atomic_store_n(&client->outbound_head, NULL, __ATOMIC_RELEASE);
+#if CONFIG_SIO_IO_TASK
+    if (sio_io_add_sender(client->client_id) != ESP_OK)
+#else
+    if (xTaskCreate(&sio_sender_task, "sio_sender", 4096, (void *)(intptr_t)client->client_id, 6, NULL) != pdPASS)
+#endif
+    {
+        client->sender_running = false;
+        __atomic_store_n(&client->outbound_head, SIO_OUTBOUND_CLOSED, __ATOMIC_RELEASE);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sio_send_packet_polling(sio_client_t *client, const Packet_t *packet)
+{
+    sio_outbound_t entry = {.packet = (Packet_t *)packet};
+
+    unlockClient(client);
+    esp_err_t err = post_packets(client, &entry, 1, packet->len);
+    lockClient(client);
+
+    return err;
+}
+
+bool sio_client_is_connected(sio_client_id_t clientId)
+{
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return false;
+    }
+
+    bool connected = sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED;
+    sio_client_release(client);
+    return connected;
+}
+
+esp_err_t sio_client_get_post_stats(sio_client_id_t clientId, sio_post_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // no send lock, the I/O task may hold it for a POST while a handler on it asks
+    stats->reused = __atomic_load_n(&client->post_stats.reused, __ATOMIC_RELAXED);
+    stats->connected = __atomic_load_n(&client->post_stats.connected, __ATOMIC_RELAXED);
+    sio_client_release(client);
+    return ESP_OK;
 }
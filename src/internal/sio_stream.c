@@ -0,0 +1,157 @@
+#include <internal/sio_stream.h>
+#include <internal/http_polling_handlers.h>
+
+#include <esp_log.h>
+#include <string.h>
+
+static const char *TAG = "[sio_stream]";
+
+// growth step for bodies of unknown size (chunked)
+#define SIO_STREAM_MIN_CAPACITY 512
+
+static void deliver(sio_stream_t *stream, PacketPointerArray_t packets)
+{
+    if (packets == NULL)
+    {
+        return;
+    }
+
+    if (stream->on_packets != NULL)
+    {
+        stream->on_packets(packets, stream->on_packets_ctx);
+    }
+    else if (stream->packets == NULL)
+    {
+        stream->packets = packets;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Previous packets were not taken, dropping new ones");
+        free_packet_arr(&packets);
+    }
+}
+
+// capacity the buffer needs for `needed` bytes plus the terminator alloc_packet_arr writes
+static size_t next_capacity(const sio_stream_t *stream, size_t needed)
+{
+    if (stream->remaining > 0)
+    {
+        return needed + stream->remaining + 1;
+    }
+
+    size_t capacity = stream->capacity < SIO_STREAM_MIN_CAPACITY ? SIO_STREAM_MIN_CAPACITY : stream->capacity;
+    while (capacity < needed + 1)
+    {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+void sio_stream_expect(sio_stream_t *stream, size_t body_len)
+{
+    stream->remaining = body_len;
+}
+
+esp_err_t sio_stream_feed(sio_stream_t *stream, const char *data, size_t len)
+{
+    stream->receiving = true;
+    stream->remaining = stream->remaining > len ? stream->remaining - len : 0;
+
+    if (stream->len + len + 1 > stream->capacity)
+    {
+        size_t capacity = next_capacity(stream, stream->len + len);
+        char *buffer = (char *)realloc(stream->buffer, capacity);
+        if (buffer == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to grow receive buffer to %d", (int)capacity);
+            sio_stream_reset(stream);
+            return ESP_ERR_NO_MEM;
+        }
+        stream->buffer = buffer;
+        stream->capacity = capacity;
+    }
+
+    memcpy(stream->buffer + stream->len, data, len);
+    stream->len += len;
+
+    if (stream->on_packets == NULL)
+    {
+        // nobody waits for early packets, parse everything at once when finished
+        return ESP_OK;
+    }
+
+    // everything up to the last delimiter is complete, hand it over and keep the tail
+    char *last_rs = NULL;
+    for (char *p = stream->buffer + stream->scanned;
+         (p = (char *)memchr(p, ASCII_RS, stream->buffer + stream->len - p)) != NULL;
+         p++)
+    {
+        last_rs = p;
+    }
+    stream->scanned = stream->len;
+
+    if (last_rs == NULL)
+    {
+        return ESP_OK;
+    }
+
+    size_t complete_len = last_rs - stream->buffer;
+    size_t tail_len = stream->len - complete_len - 1;
+
+    char *tail = NULL;
+    size_t tail_capacity = 0;
+    if (tail_len > 0 || stream->remaining > 0)
+    {
+        stream->capacity = 0;
+        tail_capacity = next_capacity(stream, tail_len);
+        tail = (char *)malloc(tail_capacity);
+        if (tail == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %d for the rest of the body", (int)tail_capacity);
+            sio_stream_reset(stream);
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(tail, last_rs + 1, tail_len);
+    }
+
+    // the complete part keeps the old buffer, the packets are views into it
+    char *complete = stream->buffer;
+    stream->buffer = tail;
+    stream->len = tail_len;
+    stream->capacity = tail_capacity;
+    stream->scanned = tail_len;
+
+    deliver(stream, alloc_packet_arr(complete, complete_len, stream->filter, stream->filter_ctx));
+    return ESP_OK;
+}
+
+void sio_stream_finish(sio_stream_t *stream)
+{
+    if (stream->buffer != NULL && stream->len > 0)
+    {
+        char *buffer = stream->buffer;
+        size_t len = stream->len;
+        stream->buffer = NULL;
+
+        sio_stream_reset(stream);
+        deliver(stream, alloc_packet_arr(buffer, len, stream->filter, stream->filter_ctx));
+    }
+    else
+    {
+        sio_stream_reset(stream);
+    }
+}
+
+void sio_stream_reset(sio_stream_t *stream)
+{
+    if (stream->buffer != NULL)
+    {
+        free(stream->buffer);
+    }
+    stream->buffer = NULL;
+    stream->len = 0;
+    stream->capacity = 0;
+    stream->scanned = 0;
+    stream->remaining = 0;
+    stream->receiving = false;
+}
@@ -0,0 +1,155 @@
+#include <sio_client.h>
+#include <internal/sio_upgrade.h>
+#include <internal/sio_websocket.h>
+#include <internal/task_functions.h>
+#include <internal/sio_io.h>
+#include <internal/sio_send.h>
+
+#include <esp_log.h>
+
+static const char *TAG = "[sio_upgrade]";
+
+// Client locked. The polling task stops after the running poll, which the server ends with a NOOP
+// once it got the probe. False if it did not stop in time, it just keeps polling then.
+static bool pause_polling(sio_client_t *client)
+{
+    client->polling_paused = true;
+
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS);
+    while (client->polling_client != NULL && xTaskGetTickCount() < deadline)
+    {
+        unlockClient(client);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        lockClient(client);
+    }
+
+    if (client->polling_client != NULL)
+    {
+        // the polling task looks at the flag under the lock, it did not see it yet
+        client->polling_paused = false;
+        return false;
+    }
+    return true;
+}
+
+// client locked
+static void resume_polling(sio_client_t *client)
+{
+    client->polling_paused = false;
+    if (sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED)
+    {
+#if CONFIG_SIO_IO_TASK
+        sio_io_add_polling(client->client_id);
+#else
+        xTaskCreate(&sio_polling_task, "sio_polling", 4096, (void *)(intptr_t)client->client_id, 6, NULL);
+#endif
+    }
+}
+
+// Client not locked. UPGRADE over the websocket while the send lock keeps POSTs out,
+// the sender sends frames from its next packet on.
+static esp_err_t switch_transport(sio_client_t *client)
+{
+    int sent = -1;
+
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    if (client->websocket_client != NULL)
+    {
+        sent = esp_websocket_client_send_text(client->websocket_client, "5", 1, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS));
+    }
+
+    if (sent >= 0)
+    {
+        // atomic instead of the client lock, that one is never taken inside the send lock
+        __atomic_store_n(&client->transport, SIO_TRANSPORT_WEBSOCKETS, __ATOMIC_RELEASE);
+
+        if (client->posting_client != NULL)
+        {
+            esp_http_client_cleanup(client->posting_client);
+            client->posting_client = NULL;
+        }
+    }
+    xSemaphoreGive(client->send_lock);
+
+    return sent < 0 ? ESP_FAIL : ESP_OK;
+}
+
+static void sio_upgrade_task(void *pvParameters)
+{
+    sio_client_id_t clientId = (sio_client_id_t)(intptr_t)pvParameters;
+
+    // the client outlives this task, sio_client_destroy waits for upgrade_running to drop
+    sio_client_t *client = sio_client_get(clientId);
+    assert(client != NULL && "Client is NULL");
+    sio_websocket_t *ws = &client->websocket;
+    bool upgraded = false;
+
+    lockClient(client);
+    esp_err_t err = sio_websocket_start(client);
+    unlockClient(client);
+
+    if (err == ESP_OK &&
+        xSemaphoreTake(ws->wait_done, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS)) == pdTRUE &&
+        ws->probe_answered)
+    {
+        lockClient(client);
+        bool paused = sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED && pause_polling(client);
+        unlockClient(client);
+
+        if (paused)
+        {
+            upgraded = switch_transport(client) == ESP_OK;
+            if (!upgraded)
+            {
+                lockClient(client);
+                resume_polling(client);
+                unlockClient(client);
+            }
+        }
+    }
+
+    if (upgraded)
+    {
+        ESP_LOGI(TAG, "Client %d upgraded to websocket", clientId);
+        // the pings of the server arrive over the websocket now
+        sio_websocket_watchdog_feed(client);
+        // what queued up during the switch goes out as frames now
+        sio_sender_wake(client);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Upgrade of client %d failed, it stays on polling", clientId);
+        sio_websocket_stop(client);
+
+        if (sio_client_get_status(client) == SIO_CLIENT_STATUS_CONNECTED)
+        {
+            sio_event_data_t event_data = {
+                .client_id = clientId,
+                .packets_pointer = NULL,
+                .len = 0};
+            esp_event_post(SIO_EVENT, SIO_EVENT_UPGRADE_TRANSPORT_ERROR, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
+        }
+    }
+
+    lockClient(client);
+    client->upgrade_running = false;
+    unlockClient(client);
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t sio_upgrade_start(sio_client_t *client)
+{
+    if (client->upgrade_running)
+    {
+        return ESP_OK;
+    }
+
+    client->upgrade_running = true;
+    if (xTaskCreate(&sio_upgrade_task, "sio_upgrade", 4096, (void *)(intptr_t)client->client_id, 5, NULL) != pdPASS)
+    {
+        client->upgrade_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,398 @@
+#include <internal/sio_websocket.h>
+#include <internal/sio_send.h>
+#include <sio_client.h>
+#include <utility.h>
+
+#include <esp_log.h>
+
+static const char *TAG = "[sio_websocket]";
+
+// opcodes of the data frames, control frames (ping, pong, close) are answered by esp_websocket_client
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_BINARY 0x2
+
+static void websocket_reset_frame(sio_websocket_t *ws)
+{
+    freeIfNotNull((void **)&ws->frame);
+    ws->frame_len = 0;
+    ws->frame_capacity = 0;
+}
+
+// the connection is gone: engine.io CLOSE, dropped socket or failed connect
+static void websocket_connection_lost(sio_client_t *client)
+{
+    sio_websocket_t *ws = &client->websocket;
+
+    lockClient(client);
+    sio_client_status_t status = sio_client_get_status(client);
+    // a failed upgrade probe leaves the client on polling
+    bool active = client->transport == SIO_TRANSPORT_WEBSOCKETS;
+    // a dropped session starts over after the backoff
+    if (active && (status == SIO_CLIENT_STATUS_CONNECTED || status == SIO_CLIENT_STATUS_HANDSHOOK) &&
+        !(status == SIO_CLIENT_STATUS_CONNECTED && sio_reconnect_schedule(client)))
+    {
+        sio_client_set_status(client, SIO_CLIENT_STATUS_CLOSED);
+    }
+    unlockClient(client);
+
+    if (ws->waiting != SIO_WEBSOCKET_WAIT_NONE)
+    {
+        ws->waiting = SIO_WEBSOCKET_WAIT_NONE;
+        xSemaphoreGive(ws->wait_done);
+    }
+
+    if (!active)
+    {
+        return;
+    }
+
+    // packets still queued can not go out anymore, let the sender fail them now
+    sio_sender_wake(client);
+
+    if (status == SIO_CLIENT_STATUS_CONNECTED)
+    {
+        sio_event_data_t event_data = {
+            .client_id = client->client_id,
+            .packets_pointer = NULL,
+            .len = 0};
+        esp_event_post(SIO_EVENT, SIO_EVENT_DISCONNECTED, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
+    }
+}
+
+// timer task, the timer id is the client id. Must not block, the worker takes it from here
+static void websocket_watchdog_expired(TimerHandle_t timer)
+{
+    sio_client_id_t clientId = (sio_client_id_t)(intptr_t)pvTimerGetTimerID(timer);
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return;
+    }
+
+    __atomic_store_n(&client->websocket.watchdog_expired, true, __ATOMIC_RELEASE);
+    sio_client_release(client);
+    sio_worker_notify(clientId);
+}
+
+void sio_websocket_watchdog_check(sio_client_t *client)
+{
+    sio_websocket_t *ws = &client->websocket;
+    if (!__atomic_exchange_n(&ws->watchdog_expired, false, __ATOMIC_ACQ_REL))
+    {
+        return;
+    }
+
+    // fed by a PING (or a new session) after it fired, or the session is over already
+    if (xTimerIsTimerActive(ws->watchdog) != pdFALSE || sio_client_get_status(client) != SIO_CLIENT_STATUS_CONNECTED ||
+        __atomic_load_n(&client->transport, __ATOMIC_ACQUIRE) != SIO_TRANSPORT_WEBSOCKETS)
+    {
+        return;
+    }
+
+    ESP_LOGW(TAG, "No ping from the server of client %d in time", client->client_id);
+    // the socket may still look open, nothing of it is read anymore
+    sio_websocket_stop(client);
+    websocket_connection_lost(client);
+}
+
+void sio_websocket_watchdog_feed(sio_client_t *client)
+{
+    sio_websocket_t *ws = &client->websocket;
+    uint32_t timeout_ms = client->server_ping_interval_ms + client->server_ping_timeout_ms;
+    if (timeout_ms == 0)
+    {
+        return;
+    }
+
+    if (ws->watchdog == NULL)
+    {
+        ws->watchdog = xTimerCreate("sio_ws_watchdog", pdMS_TO_TICKS(timeout_ms), pdFALSE,
+                                    (void *)(intptr_t)client->client_id, websocket_watchdog_expired);
+        if (ws->watchdog == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create the ping watchdog");
+            return;
+        }
+    }
+
+    // starts a stopped timer as well, an expiry the worker did not look at yet is stale now
+    __atomic_store_n(&ws->watchdog_expired, false, __ATOMIC_RELEASE);
+    xTimerChangePeriod(ws->watchdog, pdMS_TO_TICKS(timeout_ms), 0);
+}
+
+// one engine.io packet per frame, the packets take the buffer
+static void websocket_handle_frame(sio_client_t *client, char *frame, size_t len, bool binary)
+{
+    sio_websocket_t *ws = &client->websocket;
+
+    if (binary && !sio_namespace_filter_attachment(&ws->receive))
+    {
+        // belongs to a binary packet of a namespace the client did not join
+        free(frame);
+        return;
+    }
+
+    PacketPointerArray_t packets = binary ? alloc_binary_packet_arr(frame, len) : alloc_packet_arr(frame, len, sio_namespace_filter, &ws->receive);
+    if (packets == NULL)
+    {
+        return;
+    }
+
+    if (ws->waiting == SIO_WEBSOCKET_WAIT_OPEN)
+    {
+        if (packets[0]->eio_type != EIO_PACKET_OPEN)
+        {
+            ESP_LOGW(TAG, "Expected the open packet, got %d", packets[0]->eio_type);
+            free_packet_arr(&packets);
+            return;
+        }
+
+        ws->open_packets = packets;
+        ws->waiting = SIO_WEBSOCKET_WAIT_NONE;
+        xSemaphoreGive(ws->wait_done);
+        return;
+    }
+
+    if (ws->waiting == SIO_WEBSOCKET_WAIT_PROBE)
+    {
+        // nothing else comes over the websocket before the upgrade is done
+        const Packet_t *packet = packets[0];
+        if (packet->eio_type == EIO_PACKET_PONG && packet->len == 6 && memcmp(packet->data, "3probe", 6) == 0)
+        {
+            ws->probe_answered = true;
+            ws->waiting = SIO_WEBSOCKET_WAIT_NONE;
+            xSemaphoreGive(ws->wait_done);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Expected the probe answer, got %d", packet->eio_type);
+        }
+        free_packet_arr(&packets);
+        return;
+    }
+
+    if (packets[0]->eio_type == EIO_PACKET_PING)
+    {
+        sio_websocket_watchdog_feed(client);
+    }
+
+    sio_handle_packets(packets, &ws->receive);
+
+    if (ws->receive.close_received)
+    {
+        ws->receive.close_received = false;
+        websocket_connection_lost(client);
+    }
+}
+
+static void websocket_receive(sio_client_t *client, const esp_websocket_event_data_t *data)
+{
+    sio_websocket_t *ws = &client->websocket;
+
+    if (data->op_code != WS_OPCODE_TEXT && data->op_code != WS_OPCODE_BINARY && data->op_code != WS_OPCODE_CONTINUATION)
+    {
+        return;
+    }
+
+    if (data->payload_offset == 0)
+    {
+        if (data->op_code != WS_OPCODE_CONTINUATION)
+        {
+            // a new message, an unfinished one before it is lost
+            ws->frame_len = 0;
+            ws->frame_binary = data->op_code == WS_OPCODE_BINARY;
+        }
+
+        // the frame size is known from its first piece, one allocation per frame (+1 for the terminator)
+        size_t needed = ws->frame_len + data->payload_len + 1;
+        if (needed > ws->frame_capacity)
+        {
+            char *grown = (char *)realloc(ws->frame, needed);
+            if (grown == NULL)
+            {
+                ESP_LOGE(TAG, "Failed to allocate %d bytes for a frame", (int)needed);
+                websocket_reset_frame(ws);
+                return;
+            }
+            ws->frame = grown;
+            ws->frame_capacity = needed;
+        }
+    }
+
+    if (ws->frame == NULL || ws->frame_len + data->data_len >= ws->frame_capacity)
+    {
+        ESP_LOGW(TAG, "Frame data without a start, dropped");
+        return;
+    }
+
+    memcpy(ws->frame + ws->frame_len, data->data_ptr, data->data_len);
+    ws->frame_len += data->data_len;
+
+    if (!data->fin || data->payload_offset + data->data_len < data->payload_len)
+    {
+        return;
+    }
+
+    char *frame = ws->frame;
+    size_t len = ws->frame_len;
+    ws->frame = NULL;
+    ws->frame_len = 0;
+    ws->frame_capacity = 0;
+
+    websocket_handle_frame(client, frame, len, ws->frame_binary);
+}
+
+// runs on the task of esp_websocket_client, handler_args is the client id
+static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    sio_client_t *client = sio_client_acquire((sio_client_id_t)(intptr_t)handler_args);
+    if (client == NULL)
+    {
+        return;
+    }
+
+    switch (event_id)
+    {
+    case WEBSOCKET_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "Websocket of client %d connected", client->client_id);
+        if (client->websocket.waiting == SIO_WEBSOCKET_WAIT_PROBE)
+        {
+            // straight from here, the send lock may be held by a POST on the transport we are replacing
+            const esp_websocket_event_data_t *data = (const esp_websocket_event_data_t *)event_data;
+            if (esp_websocket_client_send_text(data->client, "2probe", 6, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS)) < 0)
+            {
+                ESP_LOGE(TAG, "Failed to send the upgrade probe");
+            }
+        }
+        break;
+
+    case WEBSOCKET_EVENT_DATA:
+        websocket_receive(client, (const esp_websocket_event_data_t *)event_data);
+        break;
+
+    case WEBSOCKET_EVENT_ERROR:
+    case WEBSOCKET_EVENT_DISCONNECTED:
+    case WEBSOCKET_EVENT_CLOSED:
+        ESP_LOGI(TAG, "Websocket of client %d gone, event %d", client->client_id, (int)event_id);
+        websocket_connection_lost(client);
+        break;
+
+    default:
+        break;
+    }
+    sio_client_release(client);
+}
+
+esp_err_t sio_websocket_start(sio_client_t *client)
+{
+    sio_websocket_t *ws = &client->websocket;
+
+    assert(client->websocket_client == NULL && "Websocket already running");
+
+    ws->receive = (sio_receive_state_t){
+        .client_id = client->client_id,
+        .binary_assembler = &client->binary_assembler};
+    ws->waiting = client->_server_session_id == NULL ? SIO_WEBSOCKET_WAIT_OPEN : SIO_WEBSOCKET_WAIT_PROBE;
+    ws->probe_answered = false;
+    // left over from a connection that timed out
+    xSemaphoreTake(ws->wait_done, 0);
+
+    char *url = alloc_websocket_url(client);
+
+    esp_websocket_client_config_t config = {
+        .uri = url,
+        .disable_auto_reconnect = true,
+        .network_timeout_ms = SIO_WEBSOCKET_TIMEOUT_MS,
+        .task_prio = 6,
+        .task_stack = 4096};
+    esp_websocket_client_handle_t handle = esp_websocket_client_init(&config);
+    free(url);
+
+    if (handle == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to initialize websocket client");
+        return ESP_FAIL;
+    }
+
+    esp_websocket_register_events(handle, WEBSOCKET_EVENT_ANY, websocket_event_handler, (void *)(intptr_t)client->client_id);
+
+    esp_err_t err = esp_websocket_client_start(handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start websocket client: %s", esp_err_to_name(err));
+        esp_websocket_client_destroy(handle);
+        return err;
+    }
+
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    client->websocket_client = handle;
+    xSemaphoreGive(client->send_lock);
+
+    return ESP_OK;
+}
+
+void sio_websocket_stop(sio_client_t *client)
+{
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    esp_websocket_client_handle_t handle = client->websocket_client;
+    client->websocket_client = NULL;
+    xSemaphoreGive(client->send_lock);
+
+    if (client->websocket.watchdog != NULL)
+    {
+        xTimerStop(client->websocket.watchdog, 0);
+    }
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    if (esp_websocket_client_is_connected(handle))
+    {
+        esp_websocket_client_close(handle, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS));
+    }
+    // stops the websocket task, no events after this
+    esp_websocket_client_destroy(handle);
+
+    sio_websocket_t *ws = &client->websocket;
+    websocket_reset_frame(ws);
+    ws->waiting = SIO_WEBSOCKET_WAIT_NONE;
+    if (ws->open_packets != NULL)
+    {
+        free_packet_arr(&ws->open_packets);
+    }
+    sio_binary_assembler_reset(&client->binary_assembler);
+}
+
+bool sio_websocket_is_connected(sio_client_t *client)
+{
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    bool connected = client->websocket_client != NULL && esp_websocket_client_is_connected(client->websocket_client);
+    xSemaphoreGive(client->send_lock);
+    return connected;
+}
+
+esp_err_t sio_send_packet_websocket(sio_client_t *client, const Packet_t *packet)
+{
+    int sent = -1;
+
+    xSemaphoreTake(client->send_lock, portMAX_DELAY);
+    esp_websocket_client_handle_t handle = client->websocket_client;
+    if (handle != NULL)
+    {
+        // attachments of binary events go out as binary frames, everything else is text
+        sent = packet->sio_type == SIO_PACKET_BINARY_ATTACHMENT
+                   ? esp_websocket_client_send_bin(handle, packet->data, packet->len, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS))
+                   : esp_websocket_client_send_text(handle, packet->data, packet->len, pdMS_TO_TICKS(SIO_WEBSOCKET_TIMEOUT_MS));
+    }
+    xSemaphoreGive(client->send_lock);
+
+    if (sent < 0)
+    {
+        ESP_LOGE(TAG, "Websocket send of %d bytes failed", (int)packet->len);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -2,6 +2,12 @@
 #include <internal/task_functions.h>
 #include <internal/sio_packet.h>
 #include <http_polling_handlers.h>
+#include <internal/sio_stream.h>
+#include <internal/sio_router.h>
+#include <internal/sio_ack.h>
+#include <internal/sio_reconnect.h>
+#include <internal/sio_namespace.h>
+#include <internal/sio_send.h>
 
 #include <sio_client.h>
 #include <sio_types.h>
@@ -10,162 +16,278 @@
 
 static const char *TAG = "[SIO_TASK:polling]";
 
-void sio_polling_task(void *pvParameters)
+// runs on the sender task
+static void pong_sent(sio_client_id_t client_id, esp_err_t result, void *ctx)
 {
-    sio_client_id_t clientId = (sio_client_id_t)pvParameters;
-
-    static PacketPointerArray_t response_packets;
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to send PONG packet");
+        return;
+    }
 
-    // initializing polling task
+    sio_client_t *client = sio_client_get_and_lock(client_id);
+    if (client != NULL)
     {
+        time(&client->last_sent_pong);
+        unlockClient(client);
+    }
+}
 
-        sio_client_t *client = sio_client_get_and_lock(clientId);
+// Called by the polling stream for every batch of complete packets, possibly before the poll response finished
+// (chunked / large responses), and by the websocket for every frame.
+void sio_handle_packets(PacketPointerArray_t packets, void *ctx)
+{
+    sio_receive_state_t *state = (sio_receive_state_t *)ctx;
+    bool has_message = false;
+
+    // binary events leave (or stay out of) the array until their attachments are in
+    sio_binary_assemble(state->binary_assembler, packets);
+    // the session and the offset of the last event, for a reconnect to pick up from
+    sio_recovery_track(state->client_id, packets);
+    // answers to the CONNECTs of joined namespaces, which are sent once the main one is connected
+    sio_namespace_track(state->client_id, packets);
+    // events with a sio_on handler and acks somebody waits for leave the array too
+    sio_router_dispatch(state->client_id, packets);
+    sio_ack_dispatch(state->client_id, packets);
+
+    // go through all messages and handle all non message related messages
+    for (int i = 0; packets[i] != NULL; i++)
+    {
+        Packet_t *response_packet = packets[i];
 
-        assert(client);
-        assert(client->polling_client == NULL && "Polling client is not NULL");
+        switch (response_packet->eio_type)
+        {
+        case EIO_PACKET_PING:
+            // send pong back, queued: on the websocket task waiting for the sender would block
+            // the very connection it sends on
+            Packet_t *p = alloc_control_packet(EIO_PACKET_PONG);
+            if (p == NULL || sio_send_packet_async(state->client_id, p, pong_sent, NULL) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to queue PONG packet");
+            }
+            break;
+
+        case EIO_PACKET_CLOSE:
+            ESP_LOGI(TAG, "Received close packet");
+            // we still want to send the close event here
+            state->close_received = true;
+            break;
+
+        case EIO_PACKET_MESSAGE:
+            // do nothing, will get forwarded
+            has_message = true;
+            break;
+
+        case EIO_PACKET_NOOP:
+            // the server ends a poll with it during a transport upgrade
+            break;
+
+        default:
+            ESP_LOGW(TAG, "unhandled packet type %d", response_packet->eio_type);
+            break;
+        }
+    }
 
-        char *url = alloc_polling_get_url(client);
+    if (!has_message)
+    {
+        // just heartbeat or control packets
+        free_packet_arr(&packets);
+        return;
+    }
 
-        esp_http_client_config_t config = {
-            .url = url,
-            .event_handler = http_client_polling_get_handler,
-            .user_data = &response_packets,
-            .disable_auto_redirect = true,
-            .timeout_ms = (client->server_ping_interval_ms == 0 ? 5000 : (client->server_ping_interval_ms + client->server_ping_timeout_ms * 2))};
-        client->polling_client = esp_http_client_init(&config);
-        assert(client->polling_client != NULL && "Failed to init polling client");
+    ESP_LOGI(TAG, "Received %d packets", get_array_size(packets));
+    {
+        sio_event_data_t event_data = {
+            .client_id = state->client_id,
+            .packets_pointer = packets,
+            .len = get_array_size(packets)};
 
-        unlockClient(client);
-        free(url);
+        esp_event_post(SIO_EVENT, SIO_EVENT_RECEIVED_MESSAGE, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
     }
+}
 
-    ESP_LOGI(TAG, "Started polling task for client %d", clientId);
+// client locked, state points into the polling task so the stream must not keep it
+static void release_polling_client(sio_client_t *client)
+{
+    esp_http_client_close(client->polling_client);
+    esp_http_client_cleanup(client->polling_client);
+    client->polling_client = NULL;
+    freeIfNotNull((void **)&client->poll_url);
+    client->poll_url_token = NULL;
+
+    sio_stream_reset(&client->polling_stream);
+    client->polling_stream.on_packets = NULL;
+    client->polling_stream.on_packets_ctx = NULL;
+    client->polling_stream.filter = NULL;
+    client->polling_stream.filter_ctx = NULL;
+}
 
-    while (true)
-    {
-        response_packets = NULL;
-        sio_client_t *client = sio_client_get_and_lock(clientId);
-        assert(client != NULL && "Client is NULL");
-        sio_client_status_t currentStatus = client->status;
-        unlockClient(client);
+// how long a poll may take, the server answers at the latest with its next ping
+uint32_t sio_polling_timeout_ms(const sio_client_t *client)
+{
+    return client->server_ping_interval_ms == 0 ? 5000 : (client->server_ping_interval_ms + client->server_ping_timeout_ms * 2);
+}
 
-        if (currentStatus != SIO_CLIENT_STATUS_CONNECTED)
-        {
-            ESP_LOGI(TAG, "Stopping polling task, status is %d", client->status);
-            goto end_ok;
-        }
+void sio_polling_begin(sio_client_id_t clientId, sio_receive_state_t *state, int timeout_ms, bool async)
+{
+    *state = (sio_receive_state_t){.client_id = clientId};
 
-        esp_err_t err = esp_http_client_perform(client->polling_client);
+    sio_client_t *client = sio_client_get_and_lock(clientId);
 
-        if (err != ESP_OK)
-        {
-            if (err == ESP_ERR_HTTP_EAGAIN)
-            {
-                ESP_LOGI(TAG, "HTTP request timed out. Ping timeout");
-            }
+    assert(client);
+    assert(client->polling_client == NULL && "Polling client is not NULL");
 
-            // todo: emit DISCONNECTED event on any fail
-            int r = esp_http_client_get_errno(client->polling_client);
-            ESP_LOGE(TAG, "HTTP POLLING GET request failed: %s %i", esp_err_to_name(err), r);
-            goto end_error;
-        }
+    state->binary_assembler = &client->binary_assembler;
 
-        int http_response_status_code = esp_http_client_get_status_code(client->polling_client);
-        int http_response_content_length = esp_http_client_get_content_length(client->polling_client);
+    sio_stream_t *stream = &client->polling_stream;
+    sio_stream_reset(stream);
+    stream->on_packets = sio_handle_packets;
+    stream->on_packets_ctx = state;
+    stream->filter = sio_namespace_filter;
+    stream->filter_ctx = state;
 
-        if (http_response_status_code != 200)
-        {
-            ESP_LOGW(TAG, "Polling HTTP request failed with status code %d", http_response_status_code);
-            goto end_error;
-        }
-        if (http_response_content_length <= 0)
-        {
-            ESP_LOGW(TAG, "Polling HTTP request failed: No content returned.");
-            goto end_error;
-        }
+    // every GET of the poll refreshes the token in place
+    client->poll_url = alloc_session_url(client, &client->poll_url_token);
 
-        // go through all messages and handle all non message related messages
+    esp_http_client_config_t config = {
+        .url = client->poll_url,
+        .event_handler = http_client_polling_get_handler,
+        .user_data = stream,
+        .disable_auto_redirect = true,
+        .is_async = async,
+        .timeout_ms = timeout_ms};
+    client->polling_client = esp_http_client_init(&config);
+    assert(client->polling_client != NULL && "Failed to init polling client");
 
-        for (int i = 0; i < get_array_size(response_packets); i++)
-        {
+    unlockClient(client);
 
-            Packet_t *response_packet = response_packets[0];
+    ESP_LOGI(TAG, "Started polling for client %d", clientId);
+}
 
-            switch (response_packet->eio_type)
-            {
-            case EIO_PACKET_PING:
-                // send pong back
-
-                Packet_t *p = (Packet_t *)calloc(1, sizeof(Packet_t));
-                p->data = (char *)calloc(1, 2);
-                p->len = 2;
-                setEioType(p, EIO_PACKET_PONG);
-                esp_err_t ret = sio_send_packet(client->client_id, p);
-                if (ret != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "Failed to send PONG packet");
-                }
-                else
-                {
-
-                    sio_client_t *client = sio_client_get_and_lock(clientId);
-                    time(&client->last_sent_pong);
-                    unlockClient(client);
-                }
-                free_packet(&p);
-
-                break;
-
-            case EIO_PACKET_CLOSE:
-                ESP_LOGI(TAG, "Received close packet");
-                // we still want to send the close event here
-                goto end_error;
-                break;
-
-            case EIO_PACKET_MESSAGE:
-                // do nothing, will get forwarded
-                break;
-
-            default:
-                ESP_LOGW(TAG, "unhandled packet type %d", response_packet->eio_type);
-                break;
-            }
-        }
+sio_poll_result_t sio_polling_next(sio_client_id_t clientId)
+{
+    // no lock, sio_client_close waits for the polling to end before the client can go away
+    sio_client_t *client = sio_client_get(clientId);
+    assert(client != NULL && "Client is NULL");
+    sio_client_status_t currentStatus = sio_client_get_status(client);
 
-        if (get_array_size(response_packets) == 1 && response_packets[0]->eio_type != EIO_PACKET_MESSAGE)
+    if (currentStatus != SIO_CLIENT_STATUS_CONNECTED)
+    {
+        ESP_LOGI(TAG, "Stopping polling, status is %d", currentStatus);
+        return SIO_POLL_STOP;
+    }
+
+    // decided under the lock, the upgrade can only resume polling while the client is still here
+    lockClient(client);
+    if (client->polling_paused)
+    {
+        ESP_LOGI(TAG, "Polling of client %d paused for the transport upgrade", clientId);
+        release_polling_client(client);
+        unlockClient(client);
+        return SIO_POLL_PAUSED;
+    }
+    unlockClient(client);
+
+    return SIO_POLL_CONTINUE;
+}
+
+sio_poll_result_t sio_polling_done(sio_client_id_t clientId, const sio_receive_state_t *state, esp_err_t err)
+{
+    sio_client_t *client = sio_client_get(clientId);
+
+    if (err != ESP_OK)
+    {
+        if (err == ESP_ERR_HTTP_EAGAIN || err == ESP_ERR_TIMEOUT)
         {
-            // Single package and just ping
-            continue;
+            ESP_LOGI(TAG, "HTTP request timed out. Ping timeout");
         }
 
-        ESP_LOGI(TAG, "Poller Received %d packets", get_array_size(response_packets));
-        {
-            sio_event_data_t event_data = {
-                .client_id = clientId,
-                .packets_pointer = response_packets,
-                .len = get_array_size(response_packets)};
+        int r = esp_http_client_get_errno(client->polling_client);
+        ESP_LOGE(TAG, "HTTP POLLING GET request failed: %s %i", esp_err_to_name(err), r);
+        return SIO_POLL_LOST;
+    }
 
-            esp_event_post(SIO_EVENT, SIO_EVENT_RECEIVED_MESSAGE, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
-        }
+    int http_response_status_code = esp_http_client_get_status_code(client->polling_client);
+    int http_response_content_length = esp_http_client_get_content_length(client->polling_client);
+
+    if (http_response_status_code != 200)
+    {
+        ESP_LOGW(TAG, "Polling HTTP request failed with status code %d", http_response_status_code);
+        return SIO_POLL_LOST;
+    }
+    if (http_response_content_length <= 0 && !esp_http_client_is_chunked_response(client->polling_client))
+    {
+        ESP_LOGW(TAG, "Polling HTTP request failed: No content returned.");
+        return SIO_POLL_LOST;
     }
-end_error:
-{
-    sio_event_data_t event_data = {
-        .client_id = clientId,
-        .packets_pointer = NULL,
-        .len = 0};
 
-    esp_event_post(SIO_EVENT, SIO_EVENT_DISCONNECTED, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
+    return state->close_received ? SIO_POLL_LOST : SIO_POLL_CONTINUE;
 }
-end_ok:
+
+void sio_polling_end(sio_client_id_t clientId, sio_poll_result_t result)
+{
+    if (result == SIO_POLL_PAUSED)
+    {
+        // the polling client is gone already, the upgrade owns the client now
+        return;
+    }
+
+    if (result == SIO_POLL_LOST)
+    {
+        sio_event_data_t event_data = {
+            .client_id = clientId,
+            .packets_pointer = NULL,
+            .len = 0};
+
+        esp_event_post(SIO_EVENT, SIO_EVENT_DISCONNECTED, &event_data, sizeof(sio_event_data_t), pdMS_TO_TICKS(50));
+    }
 
     sio_client_t *client = sio_client_get_and_lock(clientId);
-    client->status = SIO_CLIENT_STATUS_CLOSED;
-    esp_http_client_close(client->polling_client);
-    esp_http_client_cleanup(client->polling_client);
-    client->polling_client = NULL;
+    sio_client_status_t status = sio_client_get_status(client);
+    // a dropped session starts over after the backoff, a failed connect may have the worker at it already
+    if (!(result == SIO_POLL_LOST && status == SIO_CLIENT_STATUS_CONNECTED && sio_reconnect_schedule(client)) &&
+        status != SIO_CLIENT_STARTING)
+    {
+        sio_client_set_status(client, SIO_CLIENT_STATUS_CLOSED);
+    }
+    // packets still queued can not go out anymore, let the sender fail them now
+    sio_sender_wake(client);
+    release_polling_client(client);
+    sio_binary_assembler_reset(&client->binary_assembler);
 
     unlockClient(client);
+}
+
+void sio_polling_task(void *pvParameters)
+{
+    sio_client_id_t clientId = (sio_client_id_t)(intptr_t)pvParameters;
 
+    // lives as long as the task, which outlives the polling client
+    sio_receive_state_t state;
+    {
+        sio_client_t *client = sio_client_get(clientId);
+        assert(client != NULL && "Client is NULL");
+        sio_polling_begin(clientId, &state, sio_polling_timeout_ms(client), false);
+    }
+
+    sio_poll_result_t result;
+    while ((result = sio_polling_next(clientId)) == SIO_POLL_CONTINUE)
+    {
+        sio_client_t *client = sio_client_get(clientId);
+
+        // same url as the last GET, just a new cache buster
+        sio_write_token(client->poll_url_token);
+        esp_http_client_set_url(client->polling_client, client->poll_url);
+
+        // packets are handled by sio_handle_packets while the response comes in
+        esp_err_t err = esp_http_client_perform(client->polling_client);
+
+        if ((result = sio_polling_done(clientId, &state, err)) != SIO_POLL_CONTINUE)
+        {
+            break;
+        }
+    }
+
+    sio_polling_end(clientId, result);
     vTaskDelete(NULL);
-}
\ No newline at end of file
+}
@@ -1,28 +1,66 @@
 
 
 #include <sio_client.h>
+#include <internal/sio_send.h>
+#include <internal/sio_registry.h>
 #include <utility.h>
 #include <string.h>
 
 static const char *TAG = "[sio_client]";
 
-sio_client_t **sio_client_map = (sio_client_t **)NULL;
-
 bool sio_client_exists(const sio_client_id_t clientId);
 
-sio_client_id_t sio_client_init(const sio_client_config_t *config)
+// everything sio_client_init allocated and what a session left behind
+void sio_client_free(sio_client_t *client)
 {
+    freeIfNotNull((void **)&client->server_address);
+    freeIfNotNull((void **)&client->sio_url_path);
+    freeIfNotNull((void **)&client->nspc);
+
+    // could be allocated
+    freeIfNotNull((void **)&client->_server_session_id);
+    freeIfNotNull((void **)&client->post_url);
+    freeIfNotNull((void **)&client->poll_url);
 
-    if (sio_client_map == NULL)
+    // Remove the semaphore, cleanup all handlers
+    vSemaphoreDelete(client->client_lock);
+    vSemaphoreDelete(client->send_lock);
+    vSemaphoreDelete(client->outbound_signal);
+    vSemaphoreDelete(client->websocket.wait_done);
+    if (client->websocket.watchdog != NULL)
     {
-        sio_client_map = (sio_client_t **)calloc(SIO_MAX_PARALLEL_SOCKETS, sizeof(sio_client_t *));
-        // set all pointers to null
-        for (uint8_t i = 0; i < SIO_MAX_PARALLEL_SOCKETS; i++)
-        {
-            sio_client_map[i] = NULL;
-        }
+        // a callback still on its way finds the id gone, this may run on the timer task itself
+        xTimerDelete(client->websocket.watchdog, 0);
     }
+    if (client->polling_client != NULL)
+    {
+        ESP_ERROR_CHECK(esp_http_client_cleanup(client->polling_client));
+    }
+    if (client->posting_client != NULL)
+    {
+        ESP_ERROR_CHECK(esp_http_client_cleanup(client->posting_client));
+    }
+    if (client->handshake_client != NULL)
+    {
+        ESP_ERROR_CHECK(esp_http_client_cleanup(client->handshake_client));
+    }
+
+    sio_stream_reset(&client->polling_stream);
+    sio_stream_reset(&client->posting_stream);
+    sio_binary_assembler_reset(&client->binary_assembler);
+    sio_router_clear(&client->router);
+    sio_reconnect_clear(&client->reconnect);
+    sio_namespace_clear(&client->namespaces);
+    if (client->posting_stream.packets != NULL)
+    {
+        free_packet_arr(&client->posting_stream.packets);
+    }
+
+    free(client);
+}
 
+sio_client_id_t sio_client_init(const sio_client_config_t *config)
+{
     // some basic error checks
     if (config->server_address == NULL)
     {
@@ -30,21 +68,8 @@ sio_client_id_t sio_client_init(const sio_client_config_t *config)
         return -1;
     }
 
-    // get open slot
-    uint8_t slot = SIO_MAX_PARALLEL_SOCKETS;
-    for (uint8_t i = 0; i < SIO_MAX_PARALLEL_SOCKETS; i++)
+    if (sio_ack_init() != ESP_OK)
     {
-        if (sio_client_map[i] == NULL)
-        {
-            slot = i;
-            break;
-        }
-    }
-
-    // check if none was free
-    if (slot == SIO_MAX_PARALLEL_SOCKETS)
-    {
-        ESP_LOGE(TAG, "No slot available, clear a socket or increase the SIO_MAX_PARALLEL_SOCKETS define");
         return -1;
     }
 
@@ -52,12 +77,14 @@ sio_client_id_t sio_client_init(const sio_client_config_t *config)
 
     sio_client_t *client = (sio_client_t *)calloc(1, sizeof(sio_client_t));
 
-    client->client_id = slot;
-    client->client_lock = xSemaphoreCreateBinary();
+    // mutexes so a low priority task holding them gets boosted instead of stalling a high priority one
+    client->client_lock = xSemaphoreCreateMutex();
+    client->send_lock = xSemaphoreCreateMutex();
 
     client->status = SIO_CLIENT_INITED;
 
     assert(client->client_lock != NULL && "Could not create client lock");
+    assert(client->send_lock != NULL && "Could not create send lock");
 
     client->eio_version = config->eio_version == 0 ? SIO_DEFAULT_EIO_VERSION : config->eio_version;
 
@@ -65,9 +92,12 @@ sio_client_id_t sio_client_init(const sio_client_config_t *config)
     client->sio_url_path = strdup(config->sio_url_path == NULL ? SIO_DEFAULT_SIO_URL_PATH : config->sio_url_path);
     client->nspc = strdup(config->nspc == NULL ? SIO_DEFAULT_SIO_NAMESPACE : config->nspc);
     client->transport = config->transport;
+    client->configured_transport = config->transport;
 
     client->server_ping_interval_ms = 0;
     client->server_ping_timeout_ms = 0;
+    client->server_max_payload = SIO_DEFAULT_MAX_PAYLOAD;
+    client->server_upgrades_websocket = false;
     client->last_sent_pong = 0;
 
     client->_server_session_id = NULL;
@@ -78,63 +108,100 @@ sio_client_id_t sio_client_init(const sio_client_config_t *config)
 
     client->polling_client = NULL;
     client->posting_client = NULL;
+    client->post_url = NULL;
+    client->post_url_token = NULL;
+    client->poll_url = NULL;
+    client->poll_url_token = NULL;
     client->handshake_client = NULL;
+    client->websocket_client = NULL;
 
-    sio_client_map[slot] = client;
+    client->polling_stream = (sio_stream_t){0};
+    client->posting_stream = (sio_stream_t){0};
+    client->binary_assembler = (sio_binary_assembler_t){0};
 
-    xSemaphoreGive(client->client_lock);
+    client->reconnect = (sio_reconnect_t){0};
+
+    client->websocket = (sio_websocket_t){0};
+    client->websocket.wait_done = xSemaphoreCreateBinary();
+    assert(client->websocket.wait_done != NULL && "Could not create websocket signal");
+
+    client->outbound_head = SIO_OUTBOUND_CLOSED;
+    client->outbound_async_count = 0;
+    client->outbound_signal = xSemaphoreCreateBinary();
+    client->sender_running = false;
+    client->polling_paused = false;
+    client->upgrade_running = false;
+    assert(client->outbound_signal != NULL && "Could not create outbound signal");
 
-    ESP_LOGD(TAG, "inited client %d @ %p", slot, client);
+    // from here on lookups find it
+    sio_client_id_t clientId = sio_registry_add(client);
+    if (clientId < 0)
+    {
+        sio_client_free(client);
+        return -1;
+    }
+
+    ESP_LOGD(TAG, "inited client %d @ %p", clientId, client);
 
-    return (sio_client_id_t)slot;
+    return clientId;
 }
 
 esp_err_t sio_client_close(sio_client_id_t clientId)
 {
-    sio_client_t *client = sio_client_get_and_lock(clientId);
+    // pinned for the waits below, done without the lock
+    sio_client_t *client = sio_client_acquire(clientId);
 
     if (client == NULL)
     {
         return ESP_ERR_INVALID_ARG;
     }
+    lockClient(client);
 
-    switch (client->status)
+    switch (sio_client_get_status(client))
     {
     case SIO_CLIENT_INITED:
     case SIO_CLIENT_STATUS_CLOSED:
     case SIO_CLIENT_CLOSING:
     case SIO_CLIENT_STATUS_HANDSHAKING:
         ESP_LOGI(TAG, "Client %d in state %d closing not necessary, or in progress",
-                 clientId, client->status);
+                 clientId, sio_client_get_status(client));
         break;
 
     case SIO_CLIENT_STATUS_CONNECTED:
         // handshaking is controlled by a flag, so we set to closed and wait
         // for the sio_handshake to finish or fail
         // and now send the close packet to the server since we were connected
-        client->status = SIO_CLIENT_CLOSING;
+        sio_client_set_status(client, SIO_CLIENT_CLOSING);
         unlockClient(client);
 
         // send close packet, this may fail if the sio_handshake failed as well but that is ok
-        Packet_t *p = (Packet_t *)calloc(1, sizeof(Packet_t));
-        p->data = calloc(1, 2);
-        p->len = 2;
-        setEioType(p, EIO_PACKET_CLOSE);
+        Packet_t *p = alloc_control_packet(EIO_PACKET_CLOSE);
 
         sio_send_packet(clientId, p);
+        free_packet(&p);
+
+        // the session is over, the kept-alive POST connection can go
+        xSemaphoreTake(client->send_lock, portMAX_DELAY);
+        if (client->posting_client != NULL)
+        {
+            esp_http_client_close(client->posting_client);
+        }
+        xSemaphoreGive(client->send_lock);
 
-        // wait for the polling client to close
-        while (sio_client_get_and_lock(clientId)->polling_client == NULL)
+        // does nothing for polling
+        sio_websocket_stop(client);
+
+        // wait for the polling task to see the status and drop its client
+        lockClient(client);
+        while (client->polling_client != NULL)
         {
-            ESP_LOGI(TAG, "Waiting for polling client tot close");
+            ESP_LOGI(TAG, "Waiting for polling client to close");
             unlockClient(client);
             vTaskDelay(pdMS_TO_TICKS(1000));
+            lockClient(client);
         }
 
-        client = sio_client_get_and_lock(clientId);
-        client->status = SIO_CLIENT_CLOSING;
-
-        ESP_LOGI(TAG, "Closed client %d which was in state %d", clientId, client->status);
+        ESP_LOGI(TAG, "Closed client %d which was in state %d", clientId, sio_client_get_status(client));
 
         break;
 
@@ -144,74 +211,57 @@ esp_err_t sio_client_close(sio_client_id_t clientId)
         break;
     }
 
-    client->status = SIO_CLIENT_STATUS_CLOSED;
-
-   
-
+    sio_client_set_status(client, SIO_CLIENT_STATUS_CLOSED);
     unlockClient(client);
+    sio_client_release(client);
     return ESP_OK;
 }
 
 void sio_client_destroy(sio_client_id_t clientId)
 {
-    if (!sio_client_exists(clientId))
+    // pinned until the end, the registration may be the reference that goes last
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
     {
         return;
     }
+    lockClient(client);
 
-    sio_client_t *client = sio_client_get_and_lock(clientId);
-
-    if (client->status != SIO_CLIENT_STATUS_CLOSED)
+    if (sio_client_get_status(client) != SIO_CLIENT_STATUS_CLOSED)
     {
         ESP_LOGW(TAG, "Closing client that is not  yet closed");
         unlockClient(client);
         sio_client_close(clientId);
 
-        client = sio_client_get_and_lock(clientId);
+        lockClient(client);
     }
 
-    freeIfNotNull(&client->server_address);
-    freeIfNotNull(&client->sio_url_path);
-    freeIfNotNull(&client->nspc);
-
-    // could be allocated
-    freeIfNotNull(&client->_server_session_id);
-
-    // Remove the semaphore, cleanup all handlers
-    vSemaphoreDelete(client->client_lock);
-    if (client->polling_client != NULL)
-    {
-        ESP_ERROR_CHECK(esp_http_client_cleanup(client->polling_client));
-    }
-    if (client->posting_client != NULL)
-    {
-        ESP_ERROR_CHECK(esp_http_client_cleanup(client->posting_client));
-    }
-    if (client->handshake_client != NULL)
+    // the sender task stops (failing what is left) once it sees the client closed,
+    // the upgrade gives up as soon as its websocket is gone (sio_client_close stopped it)
+    while (client->sender_running || client->upgrade_running)
     {
-        ESP_ERROR_CHECK(esp_http_client_cleanup(client->handshake_client));
+        sio_sender_wake(client);
+        unlockClient(client);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        lockClient(client);
     }
 
-    free(client);
-    client = NULL;
-    sio_client_map[clientId] = NULL;
-    // if all of them are freed then free the map
-
-    bool allFreed = true;
-    for (uint8_t i = 0; i < SIO_MAX_PARALLEL_SOCKETS; i++)
-    {
-        if (sio_client_map[i] != NULL)
-        {
-            allFreed = false;
-            break;
-        }
-    }
+    // a websocket the server dropped is still around until here
+    unlockClient(client);
+    sio_websocket_stop(client);
+    // no more acks can arrive, the callbacks run without the client lock
+    sio_ack_cancel_all(&client->acks);
+    lockClient(client);
 
-    if (allFreed)
+    // lookups of the id fail from here on, whoever still holds the client frees it with the last release
+    bool removed = sio_registry_remove(clientId);
+    unlockClient(client);
+    if (removed)
     {
-        free(sio_client_map);
-        sio_client_map = NULL;
+        // the reference of the registration
+        sio_client_release(client);
     }
+    sio_client_release(client);
 }
 
 void sio_client_print_status(const sio_client_id_t clientId)
@@ -222,75 +272,91 @@ void sio_client_print_status(const sio_client_id_t clientId)
         return;
     }
 
-    sio_client_t *client = sio_client_get_and_lock(clientId);
+    sio_client_t *client = sio_client_acquire(clientId);
+    if (client == NULL)
+    {
+        return;
+    }
+    time_t last_sent_pong = client->last_sent_pong;
 
     ESP_LOGI(TAG, "Client %d status: %d, last sent pong: %s",
-             clientId, client->status, asctime(localtime(&client->last_sent_pong)));
-
-    unlockClient(client);
+             clientId, sio_client_get_status(client), asctime(localtime(&last_sent_pong)));
+    sio_client_release(client);
 }
 /// ---- runtime Locking
 
 bool sio_client_exists(const sio_client_id_t clientId)
 {
-
-    if (sio_client_map == NULL)
-    {
-        ESP_LOGW(TAG, "client does not exist");
-        // nothing exists
-        return false;
-    }
-
-    if (clientId >= SIO_MAX_PARALLEL_SOCKETS || clientId < 0)
-    {
-        return false;
-    }
-
-    return sio_client_map[clientId] != NULL;
+    return sio_registry_get(clientId) != NULL;
 }
 
+// the pin of a locked region goes after the lock, the last release may delete the mutex
 void unlockClient(sio_client_t *client)
 {
     ESP_LOGD(TAG, "Unlocking client %d", client->client_id);
+    sio_client_id_t clientId = client->client_id;
     xSemaphoreGive(client->client_lock);
+    sio_registry_release(clientId);
 }
 
 void lockClient(sio_client_t *client)
 {
     ESP_LOGD(TAG, "Locking client %p", client);
+    sio_registry_pin(client->client_id);
     xSemaphoreTake(client->client_lock, portMAX_DELAY);
 }
 
+sio_client_status_t sio_client_get_status(const sio_client_t *client)
+{
+    return __atomic_load_n(&client->status, __ATOMIC_ACQUIRE);
+}
+
+void sio_client_set_status(sio_client_t *client, sio_client_status_t status)
+{
+    __atomic_store_n(&client->status, status, __ATOMIC_RELEASE);
+}
+
+sio_client_t *sio_client_get(const sio_client_id_t clientId)
+{
+    return sio_registry_get(clientId);
+}
+
+sio_client_t *sio_client_acquire(const sio_client_id_t clientId)
+{
+    return sio_registry_acquire(clientId);
+}
+
+void sio_client_release(sio_client_t *client)
+{
+    sio_registry_release(client->client_id);
+}
+
 sio_client_t *sio_client_get_and_lock(const sio_client_id_t clientId)
 {
-    if (sio_client_exists(clientId))
+    // the pin of the lookup is the one of the locked region
+    sio_client_t *client = sio_registry_acquire(clientId);
+    if (client != NULL)
     {
-        lockClient(sio_client_map[clientId]);
-        return sio_client_map[clientId];
-    }
-    else
-    {
-        return NULL;
+        ESP_LOGD(TAG, "Locking client %p", client);
+        xSemaphoreTake(client->client_lock, portMAX_DELAY);
     }
+    return client;
 }
 
 bool sio_client_is_locked(const sio_client_id_t clientId)
 {
+    sio_client_t *client = sio_registry_acquire(clientId);
 
-    if (!sio_client_exists(clientId))
+    if (client == NULL)
     {
-        return NULL;
+        return false;
     }
-    else
+
+    bool locked = xSemaphoreTake(client->client_lock, (TickType_t)0) != pdTRUE;
+    if (!locked)
     {
-        if (xSemaphoreTake(sio_client_map[clientId]->client_lock, (TickType_t)0) == pdTRUE)
-        {
-            unlockClient(sio_client_map[clientId]);
-            return false;
-        }
-        else
-        {
-            return true;
-        }
+        xSemaphoreGive(client->client_lock);
     }
+    sio_client_release(client);
+    return locked;
 }
\ No newline at end of file
@@ -4,14 +4,18 @@
 #include <internal/task_functions.h>
 #include <internal/sio_handshake.h>
 #include <internal/sio_connect.h>
+#include <internal/sio_registry.h>
 
 #include <utility.h>
 #include <cJSON.h>
 
 #include "freertos/event_groups.h"
-#include "esp_wifi.h"
 #include "esp_event.h"
 
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_wifi.h"
+#endif
+
 #include <esp_log.h>
 
 bool inited = false;
@@ -32,9 +36,13 @@ void sio_got_ip(void *arg, esp_event_base_t event_base,
 {
     ESP_LOGI(TAG, "Wifi got new ip, start closed sessions everything");
 
-    for (sio_client_id_t clientId = 0; clientId < SIO_MAX_PARALLEL_SOCKETS; clientId++)
+    for (size_t slot = 0; slot < sio_registry_slots(); slot++)
     {
-        sio_client_begin(clientId);
+        sio_client_id_t clientId = sio_registry_id_at(slot);
+        if (clientId >= 0)
+        {
+            sio_client_begin(clientId);
+        }
     }
 
     xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
@@ -47,9 +55,13 @@ void sio_sta_lost(void *arg, esp_event_base_t event_base,
     xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
     // stop all clients
     ESP_LOGI(TAG, "Wifi disconnected, stop everything");
-    for (sio_client_id_t clientId = 0; clientId < SIO_MAX_PARALLEL_SOCKETS; clientId++)
+    for (size_t slot = 0; slot < sio_registry_slots(); slot++)
     {
-        sio_client_close(clientId);
+        sio_client_id_t clientId = sio_registry_id_at(slot);
+        if (clientId >= 0)
+        {
+            sio_client_close(clientId);
+        }
     }
 }
 
@@ -65,9 +77,14 @@ esp_err_t sio_init()
 
     wifi_event_group = xEventGroupCreate();
 
+#if CONFIG_IDF_TARGET_LINUX
+    // host build: there is no station to wait for, the network is always up
+    xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+#else
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &sio_got_ip, NULL, NULL));
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &sio_sta_lost, NULL, NULL));
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_STOP, &sio_sta_lost, NULL, NULL));
+#endif
 
     // subscribe to all networking events and init all queues
 
@@ -76,10 +93,107 @@ esp_err_t sio_init()
     return ESP_OK;
 }
 
+// a client whose lost polling task still holds its http client is looked at again after this
+#define SIO_WORKER_RECHECK_MS 100
+
+// clients share the 32 bits of the notification by slot, the worker looks at all clients of a bit
+#define SIO_WORKER_BIT(slot) (1u << ((slot) % 32))
+
+void sio_worker_notify(const sio_client_id_t clientId)
+{
+    if (sio_worker_handle != NULL && clientId >= 0)
+    {
+        xTaskNotify(sio_worker_handle, SIO_WORKER_BIT(SIO_REGISTRY_SLOT(clientId)), eSetBits);
+    }
+}
+
+// Handshake and connect of a client that wants to start. Returns the ticks until it wants to be looked at
+// again (backing off), 0 once it is done with the client.
+static TickType_t sio_worker_start_client(sio_client_id_t clientId)
+{
+    // pinned for the whole start, the handshake lets go of the lock while it waits for the server
+    sio_client_t *client = sio_client_acquire(clientId);
+
+    if (client == NULL)
+    {
+        return 0;
+    }
+    // a silent websocket server is dropped here instead of on the timer task
+    sio_websocket_watchdog_check(client);
+    lockClient(client);
+
+    if (sio_client_get_status(client) != SIO_CLIENT_STARTING)
+    {
+        unlockClient(client);
+        sio_client_release(client);
+        return 0;
+    }
+
+    // still backing off, or the polling task of the lost session did not let go yet
+    TickType_t due_in = sio_reconnect_due_in(&client->reconnect);
+    if (due_in > 0 || client->polling_client != NULL)
+    {
+        unlockClient(client);
+        sio_client_release(client);
+        return due_in > 0 ? due_in : pdMS_TO_TICKS(SIO_WORKER_RECHECK_MS);
+    }
+
+    // do handshake
+    esp_err_t err = sio_handshake(client);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGI(TAG, "Handshake failed for client %d %s",
+                 client->client_id, esp_err_to_name(err));
+
+        goto clientError;
+    }
+
+    ESP_LOGI(TAG, "Handshake succeeded for client %d", client->client_id);
+
+    err = sio_connect(client);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGI(TAG, "Connect failed for client %d %s",
+                 client->client_id, esp_err_to_name(err));
+
+        goto clientError;
+    }
+
+    ESP_LOGI(TAG, "Connect succeeded for client %d", client->client_id);
+    sio_reconnect_reset(&client->reconnect);
+
+    unlockClient(client);
+    sio_client_release(client);
+    return 0;
+
+clientError:
+    due_in = 0;
+    // not cancelled by a close, try again after the backoff (at least a tick, it needs another round)
+    if (sio_client_get_status(client) == SIO_CLIENT_STATUS_ERROR && sio_reconnect_schedule(client))
+    {
+        due_in = sio_reconnect_due_in(&client->reconnect);
+        due_in = due_in > 0 ? due_in : 1;
+    }
+    unlockClient(client);
+    sio_client_release(client);
+    return due_in;
+}
+
 void sio_worker_task(void *pvParameters)
 {
+    // every client once, some may have begun before the worker was there
+    uint32_t pending = UINT32_MAX;
+    TickType_t wait = 0;
+
     for (;;)
     {
+        // sio_client_begin, the ip event and reconnects set the bit of their client, nothing to do means no wake ups
+        uint32_t notified = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &notified, wait);
+        pending |= notified;
+
         // wait for connection
         xEventGroupWaitBits(wifi_event_group,
                             WIFI_CONNECTED_BIT,
@@ -87,54 +201,24 @@ void sio_worker_task(void *pvParameters)
                             pdFALSE,
                             portMAX_DELAY);
 
-        // go through all SIO clients and connect those that are waiting to be started
-
-        for (sio_client_id_t clientId = 0; clientId < SIO_MAX_PARALLEL_SOCKETS; clientId++)
+        // only the clients that asked, those backing off decide how long to sleep
+        wait = portMAX_DELAY;
+        uint32_t backing_off = 0;
+        for (size_t slot = 0; slot < sio_registry_slots(); slot++)
         {
-            sio_client_t *client = sio_client_get_and_lock(clientId);
-
-            if (client == NULL)
-            {
-                continue;
-            }
-
-            if (client->status != SIO_CLIENT_STARTING)
+            if (!(pending & SIO_WORKER_BIT(slot)))
             {
-                unlockClient(client);
                 continue;
             }
 
-            // do handshake
-            esp_err_t err = sio_handshake(client);
-
-            if (err != ESP_OK)
-            {
-                ESP_LOGI(TAG, "Handshake failed for client %d %s",
-                         client->client_id, esp_err_to_name(err));
-
-                goto clientError;
-            }
-
-            ESP_LOGI(TAG, "Handshake succeeded for client %d", client->client_id);
-
-            err = sio_connect(client);
-
-            if (err != ESP_OK)
+            TickType_t due_in = sio_worker_start_client(sio_registry_id_at(slot));
+            if (due_in > 0)
             {
-                ESP_LOGI(TAG, "Connect failed for client %d %s",
-                         client->client_id, esp_err_to_name(err));
-
-                goto clientError;
+                backing_off |= SIO_WORKER_BIT(slot);
+                wait = due_in < wait ? due_in : wait;
             }
-
-            ESP_LOGI(TAG, "Connect succeeded for client %d", client->client_id);
-
-            // start connection
-
-        clientError:
-            unlockClient(client);
         }
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        pending = backing_off;
     }
     ESP_LOGE(TAG, "SIO worker task started");
     assert(false);
@@ -151,17 +235,22 @@ esp_err_t sio_client_begin(const sio_client_id_t clientId)
         return ESP_FAIL;
     }
 
-    if (client->status != SIO_CLIENT_INITED &&
-        client->status != SIO_CLIENT_STATUS_CLOSED)
+    sio_client_status_t status = sio_client_get_status(client);
+    if (status != SIO_CLIENT_INITED &&
+        status != SIO_CLIENT_STATUS_CLOSED &&
+        status != SIO_CLIENT_STATUS_ERROR)
     {
-        ESP_LOGE(TAG, "Client %d is not in INITED or CLOSED state, but in %d", clientId, client->status);
+        ESP_LOGE(TAG, "Client %d is not in INITED, CLOSED or ERROR state, but in %d", clientId, status);
         unlockClient(client);
         return ESP_FAIL;
     }
 
-    client->status = SIO_CLIENT_STARTING;
+    // started by hand (or the network came back), no backoff
+    sio_reconnect_reset(&client->reconnect);
+    sio_client_set_status(client, SIO_CLIENT_STARTING);
 
     unlockClient(client);
+    sio_worker_notify(clientId);
 
     return ESP_OK;
 }
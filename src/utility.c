@@ -1,9 +1,11 @@
 
 #include "utility.h"
 #include <esp_assert.h>
+#include <esp_random.h>
 
 static const char *TAG = "[sio:util]";
-static const char token_charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+// yeast alphabet, 6 bits per character
+static const char token_charset[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz-_";
 
 void freeIfNotNull(void **ptr)
 {
@@ -14,65 +16,69 @@ void freeIfNotNull(void **ptr)
     }
 }
 
-// allocate new random token string on heap
-char *alloc_random_string(const size_t length)
+// Yeast style: a counter, so no two requests share a token, started at a random point
+// so the tokens of the last boot are not used again.
+static uint64_t next_token_value(void)
 {
-    char *randomString = (char *)malloc(length + 1);
+    static uint64_t counter = 0;
 
-    if (randomString != NULL)
+    uint64_t value = __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    if (value == 0)
     {
-        for (int n = 0; n < length; n++)
-        {
-            randomString[n] = token_charset[rand() % sizeof(token_charset) - 1];
-        }
-
-        randomString[length] = '\0';
+        uint64_t seed = ((uint64_t)esp_random() << 32 | esp_random()) | 1;
+        __atomic_compare_exchange_n(&counter, &value, seed, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
     }
-    else
+    return __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+}
+
+void sio_write_token(char *token)
+{
+    uint64_t value = next_token_value();
+
+    for (int n = SIO_TOKEN_SIZE - 1; n >= 0; n--)
     {
-        assert(false && "Out of memory");
+        token[n] = token_charset[value & 0x3f];
+        value >>= 6;
     }
-
-    return randomString;
 }
 
-// util
-
-char *alloc_handshake_get_url(const sio_client_t *client)
+// "<proto>://<address><path>/?EIO=<v>&transport=<transport>&t=<token>[&sid=<sid>]" in one allocation,
+// token_out (optional) points at the token inside it
+static char *alloc_url(const sio_client_t *client, sio_transport_t transport, const char *sid, char **token_out)
 {
+    const char *proto = transport == SIO_TRANSPORT_POLLING ? SIO_TRANSPORT_POLLING_PROTO_STRING : SIO_TRANSPORT_WEBSOCKETS_PROTO_STRING;
+    const char *name = transport == SIO_TRANSPORT_POLLING ? SIO_TRANSPORT_POLLING_STRING : SIO_TRANSPORT_WEBSOCKETS_STRING;
+    const char *format = "%s://%s%s/?EIO=%d&transport=%s&t=";
+
+    int prefix_len = snprintf(NULL, 0, format, proto, client->server_address, client->sio_url_path, client->eio_version, name);
+    size_t url_length = prefix_len + SIO_TOKEN_SIZE + (sid == NULL ? 0 : strlen("&sid=") + strlen(sid));
 
-    char *token = alloc_random_string(SIO_TOKEN_SIZE);
-    size_t url_length =
-        strlen(client->transport == SIO_TRANSPORT_POLLING ? SIO_TRANSPORT_POLLING_PROTO_STRING : SIO_TRANSPORT_WEBSOCKETS_PROTO_STRING) +
-        strlen("://") +
-        strlen(client->server_address) +
-        strlen(client->sio_url_path) +
-        strlen("/?EIO=X&transport=") +
-        strlen(SIO_TRANSPORT_POLLING_STRING) +
-        strlen("&t=") + strlen(token);
-
-    char *url = (char *)calloc(1, url_length + 1);
+    char *url = (char *)malloc(url_length + 1);
     if (url == NULL)
     {
-        assert(false && "Failed to allocate memory for sio_handshake url");
+        assert(false && "Failed to allocate memory for url");
         return NULL;
     }
 
-    sprintf(
-        url,
-        "%s://%s%s/?EIO=%d&transport=%s&t=%s",
-        SIO_TRANSPORT_POLLING_PROTO_STRING,
-        client->server_address,
-        client->sio_url_path,
-        client->eio_version,
-        SIO_TRANSPORT_POLLING_STRING,
-        token);
-
-    freeIfNotNull(&token);
+    sprintf(url, format, proto, client->server_address, client->sio_url_path, client->eio_version, name);
+    sio_write_token(url + prefix_len);
+    sprintf(url + prefix_len + SIO_TOKEN_SIZE, "%s%s", sid == NULL ? "" : "&sid=", sid == NULL ? "" : sid);
+
+    if (token_out != NULL)
+    {
+        *token_out = url + prefix_len;
+    }
     return url;
 }
 
-char *alloc_post_url(const sio_client_t *client)
+// util
+
+char *alloc_handshake_get_url(const sio_client_t *client)
+{
+    return alloc_url(client, SIO_TRANSPORT_POLLING, NULL, NULL);
+}
+
+char *alloc_session_url(const sio_client_t *client, char **token_out)
 {
     if (client == NULL || client->_server_session_id == NULL)
     {
@@ -80,41 +86,15 @@ char *alloc_post_url(const sio_client_t *client)
         return NULL;
     }
 
-    char *token = alloc_random_string(SIO_TOKEN_SIZE);
-    size_t url_length =
-        strlen(client->transport == SIO_TRANSPORT_POLLING ? SIO_TRANSPORT_POLLING_PROTO_STRING : SIO_TRANSPORT_WEBSOCKETS_PROTO_STRING) +
-        strlen("://") +
-        strlen(client->server_address) +
-        strlen(client->sio_url_path) +
-        strlen("/?EIO=X&transport=") +
-        strlen(SIO_TRANSPORT_POLLING_STRING) +
-        strlen("&t=") + strlen(token) +
-        strlen("&sid=") + strlen(client->_server_session_id);
-
-    char *url = (char *)calloc(1, url_length + 1);
-
-    if (url == NULL)
-    {
-        assert(false && "Failed to allocate memory for sio_handshake url");
-        return NULL;
-    }
+    return alloc_url(client, SIO_TRANSPORT_POLLING, client->_server_session_id, token_out);
+}
 
-    sprintf(
-        url,
-        "%s://%s%s/?EIO=%d&transport=%s&t=%s&sid=%s",
-        SIO_TRANSPORT_POLLING_PROTO_STRING,
-        client->server_address,
-        client->sio_url_path,
-        client->eio_version,
-        SIO_TRANSPORT_POLLING_STRING,
-        token,
-        client->_server_session_id);
-
-    freeIfNotNull(&token);
-    return url;
+char *alloc_websocket_url(const sio_client_t *client)
+{
+    return alloc_url(client, SIO_TRANSPORT_WEBSOCKETS, client->_server_session_id, NULL);
 }
 
 char *alloc_polling_get_url(const sio_client_t *client)
 {
-    return alloc_post_url(client);
-}
\ No newline at end of file
+    return alloc_session_url(client, NULL);
+}
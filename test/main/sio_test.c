@@ -0,0 +1,52 @@
+// Host tests for the parts of the component that need no server, build for the linux target:
+//   idf.py --preview set-target linux && idf.py build && ./build/sio_test.elf
+// The exit code is 1 if any check failed.
+
+#include "sio_test.h"
+
+#include <internal/sio_packet.h>
+
+#include <stdlib.h>
+
+int test_failures = 0;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {"json", test_json},
+    {"router", test_router},
+    {"packet_scan", test_packet_scan},
+    {"packet_base64", test_packet_base64},
+    {"binary_assemble", test_binary_assemble},
+    {"ack", test_ack},
+};
+
+void app_main(void)
+{
+    int failed_cases = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        int failures_before = test_failures;
+        cases[i].run();
+
+        bool ok = test_failures == failures_before;
+        failed_cases += ok ? 0 : 1;
+        printf("%-20s %s\n", cases[i].name, ok ? "ok" : "FAILED");
+    }
+
+    // every case frees what it parsed, a slot still taken is a leak
+    sio_pool_stats_t packet_pool, batch_pool;
+    sio_packet_pool_stats(&packet_pool, &batch_pool);
+    if (packet_pool.in_use != 0 || batch_pool.in_use != 0)
+    {
+        printf("pools: %u packets and %u batches still in use\n", packet_pool.in_use, batch_pool.in_use);
+        failed_cases++;
+    }
+
+    printf("%d of %d case(s) failed\n", failed_cases, (int)(sizeof(cases) / sizeof(cases[0])));
+    exit(failed_cases > 0 ? 1 : 0);
+}
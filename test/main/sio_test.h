@@ -0,0 +1,32 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdio.h>
+
+    // A failed check is reported and counted, the case goes on so one run lists every failure
+#define TEST_CHECK(cond)                                                         \
+    do                                                                           \
+    {                                                                            \
+        if (!(cond))                                                             \
+        {                                                                        \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+    extern int test_failures;
+
+    void test_json(void);
+    void test_router(void);
+    void test_packet_scan(void);
+    void test_packet_base64(void);
+    void test_binary_assemble(void);
+    void test_ack(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,124 @@
+#include "sio_test.h"
+
+#include <sio_client.h>
+#include <internal/sio_ack.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <string.h>
+
+// counts the results of one kind of ack, callbacks run on the dispatching task or the ack task
+typedef struct
+{
+    int calls;
+    esp_err_t last_result;
+    TickType_t last_tick;
+} ack_result_t;
+
+static void ack_cb(sio_client_id_t client_id, esp_err_t result, const Packet_t *packet, const char *args, size_t args_len, void *ctx)
+{
+    ack_result_t *r = (ack_result_t *)ctx;
+    r->last_result = result;
+    r->last_tick = xTaskGetTickCount();
+    __atomic_add_fetch(&r->calls, 1, __ATOMIC_RELEASE);
+}
+
+static int calls_of(ack_result_t *r)
+{
+    return __atomic_load_n(&r->calls, __ATOMIC_ACQUIRE);
+}
+
+// dispatches the answer to ack id, true if nobody waited for it and it was left in the batch
+static bool answer_left_over(sio_client_id_t client_id, uint32_t id)
+{
+    char answer[32];
+    size_t len = snprintf(answer, sizeof(answer), "43%lu[\"ok\"]", (unsigned long)id);
+    char *body = (char *)malloc(len + 1);
+    memcpy(body, answer, len + 1);
+
+    PacketPointerArray_t packets = alloc_packet_arr(body, len, NULL, NULL);
+    sio_ack_dispatch(client_id, packets);
+    bool left_over = get_array_size(packets) == 1;
+    free_packet_arr(&packets);
+    return left_over;
+}
+
+static void test_ack_ids(sio_client_id_t client_id, sio_ack_table_t *acks)
+{
+    ack_result_t answered = {0};
+    uint32_t ids[CONFIG_SIO_ACK_SLOTS];
+
+    for (size_t i = 0; i < CONFIG_SIO_ACK_SLOTS; i++)
+    {
+        TEST_CHECK(sio_ack_add(acks, client_id, ack_cb, &answered, 60000, &ids[i]) == ESP_OK);
+        TEST_CHECK(i == 0 || ids[i] == ids[i - 1] + 1);
+    }
+    uint32_t id;
+    TEST_CHECK(sio_ack_add(acks, client_id, ack_cb, &answered, 60000, &id) == ESP_ERR_NO_MEM);
+
+    // an answered id is gone, a second answer is left for the application
+    TEST_CHECK(!answer_left_over(client_id, ids[3]));
+    TEST_CHECK(calls_of(&answered) == 1 && answered.last_result == ESP_OK);
+    TEST_CHECK(answer_left_over(client_id, ids[3]));
+    TEST_CHECK(calls_of(&answered) == 1);
+
+    // ids keep counting up and skip the slots still waiting, so the next one reuses the slot of ids[3]
+    TEST_CHECK(sio_ack_add(acks, client_id, ack_cb, &answered, 60000, &id) == ESP_OK);
+    TEST_CHECK(id > ids[3] && id % CONFIG_SIO_ACK_SLOTS == ids[3] % CONFIG_SIO_ACK_SLOTS);
+    // the answer to the old id must not reach the new ack in the same slot
+    TEST_CHECK(answer_left_over(client_id, ids[3]));
+    TEST_CHECK(!answer_left_over(client_id, id));
+    TEST_CHECK(calls_of(&answered) == 2);
+
+    sio_ack_fail(acks, ids[0], ESP_FAIL);
+    TEST_CHECK(calls_of(&answered) == 3 && answered.last_result == ESP_FAIL);
+    sio_ack_remove(acks, ids[1]);
+    TEST_CHECK(calls_of(&answered) == 3);
+
+    // the rest is cancelled with the table
+    sio_ack_cancel_all(acks);
+    TEST_CHECK(calls_of(&answered) == 3 + CONFIG_SIO_ACK_SLOTS - 3);
+    TEST_CHECK(answered.last_result == ESP_ERR_INVALID_STATE);
+}
+
+static void test_ack_timeouts(sio_client_id_t client_id, sio_ack_table_t *acks)
+{
+    ack_result_t short_timeout = {0};
+    ack_result_t long_timeout = {0};
+    uint32_t short_id, long_id;
+
+    // the long one lands in a wheel slot the wheel reaches within the first turn, it has to wait for the next
+    uint32_t long_ms = SIO_ACK_WHEEL_SLOTS * SIO_ACK_WHEEL_TICK_MS + 2 * SIO_ACK_WHEEL_TICK_MS;
+    TickType_t start = xTaskGetTickCount();
+    TEST_CHECK(sio_ack_add(acks, client_id, ack_cb, &short_timeout, 250, &short_id) == ESP_OK);
+    TEST_CHECK(sio_ack_add(acks, client_id, ack_cb, &long_timeout, long_ms, &long_id) == ESP_OK);
+
+    vTaskDelay(pdMS_TO_TICKS(600));
+    TEST_CHECK(calls_of(&short_timeout) == 1 && short_timeout.last_result == ESP_ERR_TIMEOUT);
+    uint32_t waited_ms = (short_timeout.last_tick - start) * portTICK_PERIOD_MS;
+    TEST_CHECK(waited_ms >= 250 && waited_ms <= 250 + 3 * SIO_ACK_WHEEL_TICK_MS);
+    TEST_CHECK(calls_of(&long_timeout) == 0);
+
+    // a late answer is not matched anymore
+    TEST_CHECK(answer_left_over(client_id, short_id));
+    TEST_CHECK(!answer_left_over(client_id, long_id));
+    TEST_CHECK(calls_of(&long_timeout) == 1 && long_timeout.last_result == ESP_OK);
+}
+
+void test_ack(void)
+{
+    sio_client_config_t config = {.server_address = "127.0.0.1"};
+    sio_client_id_t client_id = sio_client_init(&config);
+    TEST_CHECK(client_id >= 0);
+    if (client_id < 0)
+    {
+        return;
+    }
+    sio_client_t *client = sio_client_get(client_id);
+
+    test_ack_ids(client_id, &client->acks);
+    test_ack_timeouts(client_id, &client->acks);
+
+    sio_client_destroy(client_id);
+}
@@ -0,0 +1,111 @@
+#include "sio_test.h"
+
+#include <internal/sio_json.h>
+
+#include <string.h>
+
+#define TEST_JSON_MAX_TOKENS 64
+
+typedef struct
+{
+    const char *json;
+    esp_err_t expected;
+} json_parse_case_t;
+
+static const json_parse_case_t parse_cases[] = {
+    // accepted, bytes behind the first value are ignored
+    {"42", ESP_OK},
+    {"\"s\"", ESP_OK},
+    {"{}", ESP_OK},
+    {"[]", ESP_OK},
+    {"[[],{},\"s\",1]", ESP_OK},
+    {"{\"a\" : 1 , \"b\" :[]}", ESP_OK},
+    {" {\"a\":{\"b\":[1,{\"c\":-2e3}]},\"z\":\"end\"} trailing", ESP_OK},
+    {"[\"q\\\"x\",true,false,null]", ESP_OK},
+    // cut off or no value at all
+    {"", ESP_ERR_INVALID_ARG},
+    {"x", ESP_ERR_INVALID_ARG},
+    {"[1,2", ESP_ERR_INVALID_ARG},
+    {"\"abc", ESP_ERR_INVALID_ARG},
+    {"[1}", ESP_ERR_INVALID_ARG},
+    // every key needs its ':' and one value
+    {"{1:2}", ESP_ERR_INVALID_ARG},
+    {"{\"a\" 1}", ESP_ERR_INVALID_ARG},
+    {"{\"a\" \"b\"}", ESP_ERR_INVALID_ARG},
+    {"{\"a\"}", ESP_ERR_INVALID_ARG},
+    {"{\"a\",\"b\":1}", ESP_ERR_INVALID_ARG},
+    {"{\"a\"{}}", ESP_ERR_INVALID_ARG},
+    {"{\"a\":}", ESP_ERR_INVALID_ARG},
+    {"{\"a\":,\"b\":1}", ESP_ERR_INVALID_ARG},
+    {"{\"a\":\"b\",:1}", ESP_ERR_INVALID_ARG},
+    {"[\"a\":1]", ESP_ERR_INVALID_ARG},
+    // values are separated by exactly one ','
+    {"[1 2]", ESP_ERR_INVALID_ARG},
+    {"[1,,2]", ESP_ERR_INVALID_ARG},
+    {"[,1]", ESP_ERR_INVALID_ARG},
+    {"[1,]", ESP_ERR_INVALID_ARG},
+    {"[\"x\" \"y\"]", ESP_ERR_INVALID_ARG},
+    {"[[] {}]", ESP_ERR_INVALID_ARG},
+    {"{\"a\":1,}", ESP_ERR_INVALID_ARG},
+    {"{,\"a\":1}", ESP_ERR_INVALID_ARG},
+    {"{\"a\":1 \"b\":2}", ESP_ERR_INVALID_ARG},
+};
+
+static void test_json_parse_table(void)
+{
+    sio_json_token_t tokens[TEST_JSON_MAX_TOKENS];
+    sio_json_t json;
+
+    for (size_t i = 0; i < sizeof(parse_cases) / sizeof(parse_cases[0]); i++)
+    {
+        const json_parse_case_t *c = &parse_cases[i];
+        esp_err_t err = sio_json_parse(&json, c->json, strlen(c->json), tokens, TEST_JSON_MAX_TOKENS);
+        if (err != c->expected)
+        {
+            printf("  '%s': got %s, expected %s\n", c->json, esp_err_to_name(err), esp_err_to_name(c->expected));
+        }
+        TEST_CHECK(err == c->expected);
+    }
+
+    TEST_CHECK(sio_json_parse(&json, "[1,2,3]", 7, tokens, 3) == ESP_ERR_NO_MEM);
+}
+
+static void test_json_values(void)
+{
+    sio_json_token_t tokens[TEST_JSON_MAX_TOKENS];
+    sio_json_t json;
+    const char *text = "[\"telemetry\",{\"seq\":3,\"value\":7.5,\"ok\":true,\"tags\":[\"a\",\"b\\\"c\"],\"n\":null},"
+                       "\"x\\u00e9\\ud83d\\ude00\"]";
+
+    TEST_CHECK(sio_json_parse(&json, text, strlen(text), tokens, TEST_JSON_MAX_TOKENS) == ESP_OK);
+    TEST_CHECK(json.tokens[0].size == 3);
+    TEST_CHECK(sio_json_find(&json, "[1]")->size == 5);
+
+    double number;
+    int32_t integer;
+    bool boolean;
+    char buf[32];
+    TEST_CHECK(sio_json_equals(&json, sio_json_find(&json, "[0]"), "telemetry"));
+    TEST_CHECK(sio_json_number(&json, sio_json_find(&json, "[1].value"), &number) == ESP_OK && number == 7.5);
+    TEST_CHECK(sio_json_int(&json, sio_json_find(&json, "[1].seq"), &integer) == ESP_OK && integer == 3);
+    TEST_CHECK(sio_json_bool(&json, sio_json_find(&json, "[1].ok"), &boolean) == ESP_OK && boolean);
+    TEST_CHECK(sio_json_number(&json, sio_json_find(&json, "[1].n"), &number) == ESP_ERR_INVALID_ARG);
+
+    // escapes are decoded on copy, \u pairs to UTF-8, a short buffer cuts off on a byte
+    TEST_CHECK(sio_json_copy_string(&json, sio_json_find(&json, "[1].tags[1]"), buf, sizeof(buf)) == 3 &&
+               strcmp(buf, "b\"c") == 0);
+    TEST_CHECK(sio_json_copy_string(&json, sio_json_find(&json, "[2]"), buf, sizeof(buf)) == 7 &&
+               strcmp(buf, "x\xc3\xa9\xf0\x9f\x98\x80") == 0);
+    TEST_CHECK(sio_json_copy_string(&json, sio_json_find(&json, "[2]"), buf, 3) == 7 && strcmp(buf, "x\xc3") == 0);
+
+    TEST_CHECK(sio_json_find(&json, "[1].nope") == NULL);
+    TEST_CHECK(sio_json_find(&json, "[3]") == NULL);
+    TEST_CHECK(sio_json_find(&json, "[1].tags[2]") == NULL);
+    TEST_CHECK(sio_json_find(&json, "[0].x") == NULL);
+}
+
+void test_json(void)
+{
+    test_json_parse_table();
+    test_json_values();
+}
@@ -0,0 +1,189 @@
+#include "sio_test.h"
+
+#include <internal/sio_packet.h>
+#include <internal/sio_scan.h>
+#include <internal/sio_binary.h>
+#include <internal/http_polling_handlers.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SCAN_ITERATIONS 200000
+#define TEST_BASE64_ITERATIONS 5000
+
+// alloc_packet_arr takes the buffer over
+static PacketPointerArray_t packets_of(const char *body)
+{
+    size_t len = strlen(body);
+    char *buffer = (char *)malloc(len + 1);
+    memcpy(buffer, body, len + 1);
+    return alloc_packet_arr(buffer, len, NULL, NULL);
+}
+
+void test_packet_scan(void)
+{
+    // every alignment and length around the word size, compared with a byte by byte scan
+    static const char alphabet[] = "ab{[\x1e"
+                                   "0123";
+    char buffer[128];
+    srand(1);
+
+    for (int it = 0; it < TEST_SCAN_ITERATIONS; it++)
+    {
+        size_t len = rand() % 64;
+        char *start = buffer + rand() % 8;
+        for (size_t i = 0; i < len; i++)
+        {
+            start[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+
+        char *expected_end = start + len;
+        char *expected_json = NULL;
+        for (size_t i = 0; i < len; i++)
+        {
+            if (start[i] == ASCII_RS)
+            {
+                expected_end = start + i;
+                break;
+            }
+            if (expected_json == NULL && (start[i] == '{' || start[i] == '['))
+            {
+                expected_json = start + i;
+            }
+        }
+
+        char *json = NULL;
+        char *end = sio_scan_packet(start, start + len, &json);
+        if (end != expected_end || json != expected_json)
+        {
+            printf("  scan of '%.*s' at offset %d differs\n", (int)len, start, (int)(start - buffer));
+            TEST_CHECK(end == expected_end && json == expected_json);
+            return;
+        }
+    }
+}
+
+static size_t base64_encode(const uint8_t *in, size_t len, char *out, bool pad)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t v = in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+        out[o++] = table[v >> 18 & 63];
+        out[o++] = table[v >> 12 & 63];
+        if (i + 1 < len || pad)
+        {
+            out[o++] = i + 1 < len ? table[v >> 6 & 63] : '=';
+        }
+        if (i + 2 < len || pad)
+        {
+            out[o++] = i + 2 < len ? table[v & 63] : '=';
+        }
+    }
+    return o;
+}
+
+void test_packet_base64(void)
+{
+    // random bytes, with and without padding and with line breaks, are decoded in place over the text
+    srand(2);
+    for (int it = 0; it < TEST_BASE64_ITERATIONS; it++)
+    {
+        uint8_t raw[200];
+        size_t raw_len = rand() % sizeof(raw);
+        for (size_t i = 0; i < raw_len; i++)
+        {
+            raw[i] = rand();
+        }
+
+        char encoded[280];
+        size_t encoded_len = base64_encode(raw, raw_len, encoded, rand() % 2);
+
+        char *data = (char *)malloc(2 * encoded_len + 2);
+        size_t len = 0;
+        data[len++] = 'b';
+        for (size_t i = 0; i < encoded_len; i++)
+        {
+            if (rand() % 10 == 0)
+            {
+                data[len++] = '\n';
+            }
+            data[len++] = encoded[i];
+        }
+        data[len] = '\0';
+
+        Packet_t *packet = (Packet_t *)calloc(1, sizeof(Packet_t));
+        packet->data = data;
+        packet->len = len;
+        parse_packet(packet);
+
+        bool ok = packet->sio_type == SIO_PACKET_BINARY_ATTACHMENT && packet->len == raw_len &&
+                  memcmp(packet->data, raw, raw_len) == 0;
+        free_packet(&packet);
+        if (!ok)
+        {
+            TEST_CHECK(ok);
+            return;
+        }
+    }
+
+    // in a batch every packet is decoded inside the shared buffer
+    PacketPointerArray_t packets = packets_of("bAQID\x1e"
+                                              "bAAECAwQ=\x1e"
+                                              "bA");
+    TEST_CHECK(get_array_size(packets) == 3);
+    TEST_CHECK(packets[0]->len == 3 && packets[0]->data[2] == 3);
+    TEST_CHECK(packets[1]->len == 5 && packets[1]->data[4] == 4);
+    TEST_CHECK(packets[2]->len == 0);
+    free_packet_arr(&packets);
+}
+
+void test_binary_assemble(void)
+{
+    sio_binary_assembler_t assembler = {0};
+    size_t len;
+
+    // the header and its first attachment come with one poll, the second attachment with the next
+    PacketPointerArray_t first = packets_of("2\x1e"
+                                            "452-[\"up\",{\"_placeholder\":true,\"num\":0},{\"_placeholder\":true,\"num\":1}]\x1e"
+                                            "bAQID\x1e"
+                                            "42[\"x\"]");
+    sio_binary_assemble(&assembler, first);
+    TEST_CHECK(get_array_size(first) == 2 && assembler.pending != NULL);
+    TEST_CHECK(first[0]->eio_type == EIO_PACKET_PING && first[1]->sio_type == SIO_PACKET_EVENT);
+    free_packet_arr(&first);
+
+    PacketPointerArray_t second = packets_of("bBAUG\x1e"
+                                             "3");
+    sio_binary_assemble(&assembler, second);
+    TEST_CHECK(assembler.pending == NULL && get_array_size(second) == 2);
+
+    Packet_t *header = second[0];
+    TEST_CHECK(header->sio_type == SIO_PACKET_BINARY_EVENT && header->attachment_count == 2);
+    TEST_CHECK(header->json_start != NULL && header->json_start[0] == '[');
+    const char *attachment = get_attachment(header, 0, &len);
+    TEST_CHECK(attachment != NULL && len == 3 && attachment[0] == 1);
+    attachment = get_attachment(header, 1, &len);
+    TEST_CHECK(attachment != NULL && len == 3 && attachment[0] == 4 && attachment[2] == 6);
+    TEST_CHECK(get_attachment(header, 2, &len) == NULL);
+    TEST_CHECK(second[1]->eio_type == EIO_PACKET_PONG);
+    free_packet_arr(&second);
+
+    // an attachment without header is passed on, a reset frees the header still waiting
+    PacketPointerArray_t orphan = packets_of("bAQID\x1e"
+                                             "461-/nsp,7[{\"_placeholder\":true,\"num\":0}]");
+    sio_binary_assemble(&assembler, orphan);
+    TEST_CHECK(get_array_size(orphan) == 1 && orphan[0]->sio_type == SIO_PACKET_BINARY_ATTACHMENT);
+    TEST_CHECK(assembler.pending != NULL && assembler.pending->sio_type == SIO_PACKET_BINARY_ACK);
+    free_packet_arr(&orphan);
+    sio_binary_assembler_reset(&assembler);
+    TEST_CHECK(assembler.pending == NULL);
+
+    // no valid attachment count, passed on as it is
+    PacketPointerArray_t invalid = packets_of("45x-[]");
+    TEST_CHECK(invalid[0]->attachment_count == 0);
+    sio_binary_assemble(&assembler, invalid);
+    TEST_CHECK(get_array_size(invalid) == 1 && assembler.pending == NULL);
+    free_packet_arr(&invalid);
+}
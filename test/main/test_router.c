@@ -0,0 +1,195 @@
+#include "sio_test.h"
+
+#include <internal/sio_router.h>
+
+#include <string.h>
+
+#define TEST_ROUTE_NAME_SIZE 16
+
+// same FNV-1a as the router, to pick names that land on a given home slot
+static size_t home_slot(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *p = name; *p != '\0'; p++)
+    {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash % CONFIG_SIO_ROUTER_SIZE;
+}
+
+// fills names with count fresh names whose home slot is home
+static void colliding_names(size_t home, size_t count, char names[][TEST_ROUTE_NAME_SIZE])
+{
+    static unsigned next = 0;
+    for (size_t found = 0; found < count; next++)
+    {
+        snprintf(names[found], TEST_ROUTE_NAME_SIZE, "ev%u", next);
+        if (home_slot(names[found]) == home)
+        {
+            found++;
+        }
+    }
+}
+
+static void handler(sio_client_id_t client_id, const Packet_t *packet, const char *args, size_t args_len, void *ctx)
+{
+}
+
+// Linear probing only finds an entry if no free slot lies between its home slot and itself,
+// every delete has to keep that true for all entries left.
+static bool router_consistent(const sio_router_t *router)
+{
+    size_t used = 0;
+    for (size_t slot = 0; slot < CONFIG_SIO_ROUTER_SIZE; slot++)
+    {
+        const sio_route_t *route = &router->routes[slot];
+        if (route->name == NULL)
+        {
+            continue;
+        }
+        used++;
+        for (size_t probe = route->hash % CONFIG_SIO_ROUTER_SIZE; probe != slot; probe = (probe + 1) % CONFIG_SIO_ROUTER_SIZE)
+        {
+            if (router->routes[probe].name == NULL)
+            {
+                printf("  '%s' in slot %u is cut off from its home slot by free slot %u\n", route->name,
+                       (unsigned)slot, (unsigned)probe);
+                return false;
+            }
+        }
+    }
+    return used == router->count;
+}
+
+// adding a registered event only swaps its handler, so the count stays if the lookup finds it
+static bool router_has(sio_router_t *router, const char *name)
+{
+    uint8_t count = router->count;
+    if (sio_router_add(router, name, handler, NULL) != ESP_OK)
+    {
+        return false;
+    }
+    if (router->count == count)
+    {
+        return true;
+    }
+    sio_router_remove(router, name);
+    return false;
+}
+
+static void test_router_chains(void)
+{
+    sio_router_t router = {0};
+    char chain_a[3][TEST_ROUTE_NAME_SIZE];
+    char chain_b[2][TEST_ROUTE_NAME_SIZE];
+
+    // a takes slots 2-4, b is pushed behind it into 5-6
+    colliding_names(2, 3, chain_a);
+    colliding_names(3, 2, chain_b);
+    for (size_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(sio_router_add(&router, chain_a[i], handler, NULL) == ESP_OK);
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        TEST_CHECK(sio_router_add(&router, chain_b[i], handler, NULL) == ESP_OK);
+    }
+    TEST_CHECK(router.count == 5 && router_consistent(&router));
+
+    // the hole at the head of a is filled from both chains
+    TEST_CHECK(sio_router_remove(&router, chain_a[0]) == ESP_OK);
+    TEST_CHECK(router.count == 4 && router_consistent(&router));
+    TEST_CHECK(!router_has(&router, chain_a[0]));
+    TEST_CHECK(router_has(&router, chain_a[1]) && router_has(&router, chain_a[2]));
+    TEST_CHECK(router_has(&router, chain_b[0]) && router_has(&router, chain_b[1]));
+    TEST_CHECK(sio_router_remove(&router, chain_a[0]) == ESP_ERR_NOT_FOUND);
+
+    // b moved into a's slots, removing from the middle must not strand its tail
+    TEST_CHECK(sio_router_remove(&router, chain_b[0]) == ESP_OK);
+    TEST_CHECK(router_consistent(&router) && router_has(&router, chain_b[1]));
+    TEST_CHECK(sio_router_remove(&router, chain_a[2]) == ESP_OK);
+    TEST_CHECK(router_consistent(&router) && router_has(&router, chain_a[1]) && router_has(&router, chain_b[1]));
+    TEST_CHECK(sio_router_remove(&router, chain_a[1]) == ESP_OK);
+    TEST_CHECK(sio_router_remove(&router, chain_b[1]) == ESP_OK);
+    TEST_CHECK(router.count == 0 && router_consistent(&router));
+
+    sio_router_clear(&router);
+}
+
+static void test_router_wrap(void)
+{
+    sio_router_t router = {0};
+    char last[3][TEST_ROUTE_NAME_SIZE];
+    char first[1][TEST_ROUTE_NAME_SIZE];
+
+    // the chain of the last slot wraps into 0 and 1, the entry of slot 0 ends up in 2
+    colliding_names(CONFIG_SIO_ROUTER_SIZE - 1, 3, last);
+    colliding_names(0, 1, first);
+    for (size_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(sio_router_add(&router, last[i], handler, NULL) == ESP_OK);
+    }
+    TEST_CHECK(sio_router_add(&router, first[0], handler, NULL) == ESP_OK);
+    TEST_CHECK(router.routes[2].name != NULL && strcmp(router.routes[2].name, first[0]) == 0);
+
+    // the hole moves across the end of the table
+    TEST_CHECK(sio_router_remove(&router, last[0]) == ESP_OK);
+    TEST_CHECK(router_consistent(&router));
+    TEST_CHECK(router_has(&router, last[1]) && router_has(&router, last[2]) && router_has(&router, first[0]));
+    TEST_CHECK(router.routes[1].name != NULL && strcmp(router.routes[1].name, first[0]) == 0);
+
+    TEST_CHECK(sio_router_remove(&router, last[2]) == ESP_OK);
+    TEST_CHECK(router_consistent(&router) && router_has(&router, first[0]));
+
+    sio_router_clear(&router);
+}
+
+static void test_router_full(void)
+{
+    sio_router_t router = {0};
+    char names[CONFIG_SIO_ROUTER_SIZE][TEST_ROUTE_NAME_SIZE];
+
+    for (size_t i = 0; i < CONFIG_SIO_ROUTER_SIZE; i++)
+    {
+        snprintf(names[i], TEST_ROUTE_NAME_SIZE, "e%u", (unsigned)i);
+        TEST_CHECK(sio_router_add(&router, names[i], handler, NULL) == ESP_OK);
+    }
+    TEST_CHECK(sio_router_add(&router, "more", handler, NULL) == ESP_ERR_NO_MEM);
+
+    for (size_t i = 0; i < CONFIG_SIO_ROUTER_SIZE; i += 3)
+    {
+        TEST_CHECK(sio_router_remove(&router, names[i]) == ESP_OK);
+        TEST_CHECK(router_consistent(&router));
+    }
+    for (size_t i = 0; i < CONFIG_SIO_ROUTER_SIZE; i++)
+    {
+        TEST_CHECK(router_has(&router, names[i]) == (i % 3 != 0));
+    }
+    for (size_t i = 0; i < CONFIG_SIO_ROUTER_SIZE; i++)
+    {
+        if (i % 3 != 0)
+        {
+            TEST_CHECK(sio_router_remove(&router, names[i]) == ESP_OK);
+            TEST_CHECK(router_consistent(&router));
+        }
+    }
+    TEST_CHECK(router.count == 0);
+
+    sio_router_clear(&router);
+}
+
+void test_router(void)
+{
+    // the collision cases place chains on slots 0-6 and around the end of the table
+    if (CONFIG_SIO_ROUTER_SIZE < 8)
+    {
+        printf("  CONFIG_SIO_ROUTER_SIZE < 8, only the full table case runs\n");
+    }
+    else
+    {
+        test_router_chains();
+        test_router_wrap();
+    }
+    test_router_full();
+}